@@ -7,33 +7,374 @@
 #include <sys/time.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
 #include <linux/fs.h>
+#include <linux/io_uring.h>
 #include <string.h>
 #include <errno.h>
 #include <time.h>
 #include <math.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
 
 #define BLOCK_SIZE_DEFAULT          512
 #define MAX_CATEGORIES              20
-#define MIN_REPORT_INTERVAL         1000
-#define DEFAULT_SUSPECT_THRESHOLD   100
+#define US_PER_MS                   1000L
+#define US_PER_SEC                  1000000L
+#define LATENCY_ERROR_US            (1000 * US_PER_SEC)     // 读取失败时记录的耗时
+#define DEFAULT_LOG_THRESHOLD       (100 * US_PER_MS)
+#define DEFAULT_SUSPECT_THRESHOLD   (100 * US_PER_MS)
 #define DEFAULT_SUSPECT_RETRIES     10
-#define DEFAULT_SUSPECT_INTERVAL    100
+#define DEFAULT_SUSPECT_INTERVAL    0
+#define RETEST_FAR_DISTANCE         (1L << 30)  // 冲刷读取距可疑块至少这么远（字节）
+#define RETEST_BATCH                16          // 后台重测线程一次交错重测的可疑块数
+#define DEFAULT_QUEUE_DEPTH         32
+#define DEFAULT_TOP_RANGES          10
+#define DEFAULT_FS_BLOCK_SIZE       4096
+#define TIME_BUDGET_CHECK_US        200000  // 时间预算每 200ms 检查一次
+#define TIME_BUDGET_WARMUP_US       1000000 // 实测 1 秒后才开始按速度调整样本数
+#define TIME_BUDGET_MARGIN          0.95    // 预留 5% 时间给重测和收尾
+#define TIME_BUDGET_EWMA_ALPHA      0.2
+#define DEFAULT_CHECKPOINT_INTERVAL 60
+#define DEFAULT_LDC_WINDOW_HDD      1024
+#define REFINE_FACTOR               8       // 每级加密把采样间距缩小到约 1/8
+#define REFINE_MAX_REGIONS          64
+#define REFINE_DONE_REGIONS         32
+#define MAX_QUEUE_DEPTH             4096
+#define MAX_THREADS                 256
+#define PROGRESS_INTERVAL_US        500000  // 进度行每 0.5 秒刷新一次
+#define PROGRESS_EWMA_TAU_SEC       3.0     // 瞬时速度的平滑时间常数
+#define ETA_ZONES                   64      // 剩余时间估计把扫描范围按块号等分的区域数
+#define ETA_ZONE_MIN_BLOCKS         8       // 区域内至少读过这么多块才采用该区域的实测速度
+#define ETA_MIN_INNER_RATIO         0.4     // 机械硬盘外推时内圈速度不低于外圈的比例
+#define HEATMAP_LBA_BUCKETS         1024    // 热力图按块号等分的行数
+#define HEATMAP_LATENCY_BUCKETS     23      // 延迟列：[2^i, 2^(i+1)) 微秒，末列包含 ≥ 4.19s
+#define HEATMAP_ERROR_COLUMN        HEATMAP_LATENCY_BUCKETS     // 读取错误单独一列
+#define HEATMAP_COLUMNS             (HEATMAP_LATENCY_BUCKETS + 1)
+#define HEATMAP_ASCII_ROWS          32
+#define HEATMAP_PGM_CELL_WIDTH      16      // PGM 图像中每列的像素宽度
+#define PROFILE_DEFAULT_WINDOWS     256     // 吞吐曲线按块号等分的窗口数
+#define PROFILE_MAX_WINDOWS         65536
+#define PROFILE_MIN_CHUNK           (1 << 20)   // 吞吐曲线的读请求至少 1MiB
+#define PROFILE_DIP_RATIO           0.7     // 窗口速度低于拟合曲线的这个比例视为凹陷
+#define PROFILE_ASCII_COLUMNS       64
+#define PROFILE_ASCII_ROWS          12
+#define CALIBRATE_READ_SIZE         4096
+#define CALIBRATE_ROTATION_SAMPLES  200     // 测量旋转延迟的读取对数
+#define CALIBRATE_SKIP_MIN          (2 << 20)   // 测量旋转延迟时向后跳过的距离（字节），超过一个磁道
+#define CALIBRATE_SKIP_MAX          (8 << 20)
+#define CALIBRATE_SEEK_DISTANCES    8       // 寻道距离的档数，每档 ×4
+#define CALIBRATE_SEEK_SAMPLES      32      // 每档距离的读取对数
+#define CALIBRATE_MIN_RPM           3600
+#define CALIBRATE_MAX_RPM           20000
+#define CALIBRATE_RPM_TOLERANCE     0.08    // 实测转速与常见规格相差不超过 8% 时按规格取值
+#define BENCH_MIN_BLOCK             512
+#define BENCH_MAX_BLOCK             (4 << 20)
+#define BENCH_MAX_DEPTH             256
+#define DEFAULT_BENCH_CELL_US       (500 * US_PER_MS)   // 基准测试每个组合的测量时长
+#define BENCH_NEAR_BEST             0.95    // 速度不低于最快组合的 95% 时优先选更小的块和队列深度
+#define BENCH_DB_FILE               ".good-blocks-bench"    // 位于 $HOME，按型号保存基准测试的推荐参数
+
+typedef enum {
+    ENGINE_SYNC = 0,    // 同步 lseek + read，每次一个请求
+    ENGINE_URING,       // io_uring 异步读取，保持多个请求在途
+    ENGINE_THREADS,     // 多线程 pread，每个线程负责一段块范围
+} ScanEngine;
 
 typedef struct {
     unsigned long   block_num;
     int             is_suspect;
-    long            final_elapsed;
+    long            final_elapsed;  // 微秒
 } BlockResult;
 
 typedef struct {
     char    name[20];
-    long    max_time;
+    long    max_time;   // 微秒
     char    color[20];
     long    count;
 } TimeCategory;
 
+// 计算两个时间点之间的间隔（微秒）
+long timespec_diff_us(const struct timespec *start, const struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * US_PER_SEC +
+           (end->tv_nsec - start->tv_nsec) / 1000;
+}
+
+// 把时间点提前 us 微秒（续扫时让计时覆盖之前各次运行）
+void timespec_sub_us(struct timespec *ts, long us) {
+    ts->tv_sec -= us / US_PER_SEC;
+    ts->tv_nsec -= (us % US_PER_SEC) * 1000;
+    if (ts->tv_nsec < 0) {
+        ts->tv_sec--;
+        ts->tv_nsec += 1000000000L;
+    }
+}
+
+// 把时间点推后 us 微秒
+void timespec_add_us(struct timespec *ts, long us) {
+    ts->tv_sec += us / US_PER_SEC;
+    ts->tv_nsec += (us % US_PER_SEC) * 1000;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+// 解析延迟值，支持 ns/us/ms/s 单位后缀，无后缀时按 ms 处理
+// 成功返回 0 并以微秒写入 out_us，失败返回 -1
+int parse_latency(const char *str, long *out_us) {
+    char *endptr;
+    double value = strtod(str, &endptr);
+    if (endptr == str || value < 0) return -1;
+
+    while (isspace(*endptr)) endptr++;
+
+    double scale;
+    const char *rest;
+    if (strncmp(endptr, "ns", 2) == 0) {
+        scale = 0.001;          rest = endptr + 2;
+    } else if (strncmp(endptr, "us", 2) == 0) {
+        scale = 1;              rest = endptr + 2;
+    } else if (strncmp(endptr, "µs", strlen("µs")) == 0) {
+        scale = 1;              rest = endptr + strlen("µs");
+    } else if (strncmp(endptr, "ms", 2) == 0) {
+        scale = US_PER_MS;      rest = endptr + 2;
+    } else if (*endptr == 's') {
+        scale = US_PER_SEC;     rest = endptr + 1;
+    } else {
+        scale = US_PER_MS;      rest = endptr;
+    }
+
+    while (isspace(*rest)) rest++;
+    if (*rest != '\0') return -1;
+
+    *out_us = (long)(value * scale + 0.5);
+    return 0;
+}
+
+// 解析时长，支持 s/m/h 单位后缀，无后缀时按秒处理。成功返回 0 并以秒写入 out_sec
+int parse_duration(const char *str, long *out_sec) {
+    char *endptr;
+    double value = strtod(str, &endptr);
+    if (endptr == str || value <= 0) return -1;
+
+    while (isspace(*endptr)) endptr++;
+
+    double scale = 1;
+    if (*endptr == 'h') {
+        scale = 3600;   endptr++;
+    } else if (strncmp(endptr, "min", 3) == 0) {
+        scale = 60;     endptr += 3;
+    } else if (*endptr == 'm') {
+        scale = 60;     endptr++;
+    } else if (*endptr == 's') {
+        endptr++;
+    }
+
+    while (isspace(*endptr)) endptr++;
+    if (*endptr != '\0') return -1;
+
+    *out_sec = (long)(value * scale + 0.5);
+    return *out_sec > 0 ? 0 : -1;
+}
+
+// 将微秒延迟格式化为易读的字符串（如 80us、1.5ms、2s）
+const char *format_latency(long us, char *buf, size_t size) {
+    if (us < US_PER_MS) {
+        snprintf(buf, size, "%ldus", us);
+    } else if (us < US_PER_SEC) {
+        if (us % US_PER_MS == 0) {
+            snprintf(buf, size, "%ldms", us / US_PER_MS);
+        } else {
+            snprintf(buf, size, "%.3gms", (double)us / US_PER_MS);
+        }
+    } else if (us % US_PER_SEC == 0) {
+        snprintf(buf, size, "%lds", us / US_PER_SEC);
+    } else {
+        snprintf(buf, size, "%.3gs", (double)us / US_PER_SEC);
+    }
+    return buf;
+}
+
+// 输出 JSON 字符串（含引号），转义引号、反斜杠和控制字符，其余 UTF-8 字节原样输出
+void json_write_string(FILE *out, const char *str) {
+    fputc('"', out);
+    for (const unsigned char *p = (const unsigned char *)str; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fputc('\\', out);
+            fputc(*p, out);
+        } else if (*p < 0x20) {
+            fprintf(out, "\\u%04x", *p);
+        } else {
+            fputc(*p, out);
+        }
+    }
+    fputc('"', out);
+}
+
+// 对数线性延迟直方图（HDR 风格）：每个 2 的幂区间细分为 HIST_SUB_BUCKETS 个桶，
+// 相对误差不超过 1/HIST_SUB_BUCKETS，内存固定，记录一个样本为 O(1) 且不分配内存
+#define HIST_SUB_BUCKET_BITS    6
+#define HIST_SUB_BUCKETS        (1 << HIST_SUB_BUCKET_BITS)
+#define HIST_MAX_VALUE_US       (60 * US_PER_SEC)
+#define HIST_MAX_MAGNITUDE      25      // floor(log2(HIST_MAX_VALUE_US))
+#define HIST_BUCKET_COUNT       ((HIST_MAX_MAGNITUDE - HIST_SUB_BUCKET_BITS + 2) * HIST_SUB_BUCKETS)
+
+typedef struct {
+    unsigned long   buckets[HIST_BUCKET_COUNT];
+    unsigned long   count;
+    unsigned long   sum;        // 微秒
+    double          sum_sq;     // 微秒²
+    long            min;
+    long            max;
+} LatencyHistogram;
+
+void histogram_init(LatencyHistogram *hist) {
+    memset(hist, 0, sizeof(*hist));
+    hist->min = -1;
+}
+
+// 计算样本值所在的桶序号
+int histogram_bucket_index(long value) {
+    if (value < 1) value = 1;
+    if (value > HIST_MAX_VALUE_US) value = HIST_MAX_VALUE_US;
+
+    int magnitude = 63 - __builtin_clzl((unsigned long)value);
+    int shift = magnitude - HIST_SUB_BUCKET_BITS;
+    if (shift < 0) shift = 0;
+
+    return shift * HIST_SUB_BUCKETS + (int)(value >> shift);
+}
+
+// 桶所代表的数值区间中点
+long histogram_bucket_value(int index) {
+    if (index < 2 * HIST_SUB_BUCKETS) return index;
+
+    int shift = index / HIST_SUB_BUCKETS - 1;
+    long low = (long)(index - shift * HIST_SUB_BUCKETS) << shift;
+    return low + ((1L << shift) >> 1);
+}
+
+// 记录一个延迟样本（微秒）
+void histogram_record(LatencyHistogram *hist, long value) {
+    hist->buckets[histogram_bucket_index(value)]++;
+    hist->count++;
+    hist->sum += value;
+    hist->sum_sq += (double)value * value;
+    if (hist->min < 0 || value < hist->min) hist->min = value;
+    if (value > hist->max) hist->max = value;
+}
+
+// 返回给定百分位（0-100）对应的延迟（微秒）
+long histogram_percentile(const LatencyHistogram *hist, double percentile) {
+    if (hist->count == 0) return 0;
+
+    unsigned long target = (unsigned long)ceil(percentile / 100.0 * hist->count);
+    if (target < 1) target = 1;
+
+    unsigned long seen = 0;
+    for (int i = 0; i < HIST_BUCKET_COUNT; i++) {
+        seen += hist->buckets[i];
+        if (seen >= target) {
+            long value = histogram_bucket_value(i);
+            if (value > hist->max) value = hist->max;
+            if (value < hist->min) value = hist->min;
+            return value;
+        }
+    }
+    return hist->max;
+}
+
+// 把 other 合并到 hist 中
+void histogram_merge(LatencyHistogram *hist, const LatencyHistogram *other) {
+    if (other->count == 0) return;
+    for (int i = 0; i < HIST_BUCKET_COUNT; i++) {
+        hist->buckets[i] += other->buckets[i];
+    }
+    hist->count += other->count;
+    hist->sum += other->sum;
+    hist->sum_sq += other->sum_sq;
+    if (hist->min < 0 || other->min < hist->min) hist->min = other->min;
+    if (other->max > hist->max) hist->max = other->max;
+}
+
+double histogram_mean(const LatencyHistogram *hist) {
+    return hist->count > 0 ? (double)hist->sum / hist->count : 0.0;
+}
+
+double histogram_stddev(const LatencyHistogram *hist) {
+    if (hist->count < 2) return 0.0;
+    double mean = histogram_mean(hist);
+    double variance = hist->sum_sq / hist->count - mean * mean;
+    return variance > 0 ? sqrt(variance) : 0.0;
+}
+
+// 扫描统计：每个工作线程各自累计，扫描结束后合并
+typedef struct {
+    LatencyHistogram    histogram;          // 所有成功读取的首次读取延迟
+    unsigned long       bisect_reads;       // 分层扫描中细分读取的次数
+    unsigned long       located_slow;       // 定位到的最小粒度慢区间数
+    unsigned long       located_errors;     // 定位到的最小粒度读取错误区间数
+    unsigned long       retested;           // 重测的块（或最小粒度区间）数
+    unsigned long       retest_reads;       // 重测读取的次数（不含冲刷读取）
+    unsigned long       scanned;            // 实际扫描的块数
+    unsigned long       refine_regions;     // 自适应加密采样安排的区域数
+    unsigned long       refine_samples;     // 加密区域中安排的样本数
+    // 按区域统计成功读取的块数和延迟总和，用于估计剩余时间；以 relaxed 原子操作写入，进度线程随时读取
+    unsigned long       zone_blocks[ETA_ZONES];
+    unsigned long       zone_latency_us[ETA_ZONES];
+    // 二维热力图：LBA 位置 × 延迟区间的块数，首次读取的结果
+    uint32_t            heatmap[HEATMAP_LBA_BUCKETS][HEATMAP_COLUMNS];
+} ScanStats;
+
+void scan_stats_init(ScanStats *stats) {
+    histogram_init(&stats->histogram);
+    stats->bisect_reads = 0;
+    stats->located_slow = 0;
+    stats->located_errors = 0;
+    stats->retested = 0;
+    stats->retest_reads = 0;
+    stats->scanned = 0;
+    stats->refine_regions = 0;
+    stats->refine_samples = 0;
+    memset(stats->zone_blocks, 0, sizeof(stats->zone_blocks));
+    memset(stats->zone_latency_us, 0, sizeof(stats->zone_latency_us));
+    memset(stats->heatmap, 0, sizeof(stats->heatmap));
+}
+
+void scan_stats_merge(ScanStats *stats, const ScanStats *other) {
+    histogram_merge(&stats->histogram, &other->histogram);
+    stats->bisect_reads += other->bisect_reads;
+    stats->located_slow += other->located_slow;
+    stats->located_errors += other->located_errors;
+    stats->retested += other->retested;
+    stats->retest_reads += other->retest_reads;
+    stats->scanned += other->scanned;
+    stats->refine_regions += other->refine_regions;
+    stats->refine_samples += other->refine_samples;
+    for (int i = 0; i < ETA_ZONES; i++) {
+        stats->zone_blocks[i] += other->zone_blocks[i];
+        stats->zone_latency_us[i] += other->zone_latency_us[i];
+    }
+    for (int i = 0; i < HEATMAP_LBA_BUCKETS; i++) {
+        for (int j = 0; j < HEATMAP_COLUMNS; j++) {
+            stats->heatmap[i][j] += other->heatmap[i][j];
+        }
+    }
+}
+
+// 延迟所在的热力图列
+int heatmap_latency_column(long us) {
+    if (us < 2) return 0;
+    int column = 63 - __builtin_clzl((unsigned long)us);
+    return column < HEATMAP_LATENCY_BUCKETS ? column : HEATMAP_LATENCY_BUCKETS - 1;
+}
+
 // 从文件加载时间分类
 int load_categories(const char *filename, TimeCategory *cats) {
     FILE *file = fopen(filename, "r");
@@ -49,11 +390,16 @@ int load_categories(const char *filename, TimeCategory *cats) {
         if (line[0] == '#' || line[0] == '\n') continue;
 
         char name[20] = {0};
+        char time_str[32] = {0};
         char color[20] = {0};
         long max_time = 0;
 
-        // 解析行: 名称,时间,颜色
-        if (sscanf(line, "%19[^,],%ld,%19s", name, &max_time, color) == 3) {
+        // 解析行: 名称,时间,颜色（时间可带 us/ms/s 单位，缺省为 ms）
+        if (sscanf(line, "%19[^,],%31[^,],%19s", name, time_str, color) == 3) {
+            if (parse_latency(time_str, &max_time) != 0) {
+                fprintf(stderr, "警告: 配置文件中的时间 '%s' 无效，跳过该行\n", time_str);
+                continue;
+            }
             strncpy(cats[count].name, name, sizeof(cats[count].name));
             cats[count].max_time = max_time;
             strncpy(cats[count].color, color, sizeof(cats[count].color));
@@ -83,75 +429,104 @@ int load_categories(const char *filename, TimeCategory *cats) {
 // 打印时间分类定义
 void print_category_definitions(TimeCategory *cats, int count) {
     printf("\033[33m【准备扫描】\033[m时间分类定义:\n");
+    char latency[32];
     for (int i = 0; i < count; i++) {
+        format_latency(cats[i].max_time, latency, sizeof(latency));
         if (i < count - 2) {
-            printf("\033[33m【准备扫描】\033[m  %s%s\033[0m: ≤ %4ld ms\n", cats[i].color, cats[i].name, cats[i].max_time);
+            printf("\033[33m【准备扫描】\033[m  %s%s\033[0m: ≤ %6s\n", cats[i].color, cats[i].name, latency);
         } else {
-            printf("\033[33m【准备扫描】\033[m  %s%s\033[0m: > %4ld ms\n", cats[i].color, cats[i].name, cats[i].max_time);
+            printf("\033[33m【准备扫描】\033[m  %s%s\033[0m: > %6s\n", cats[i].color, cats[i].name, latency);
         }
     }
 }
 
-// 日志记录函数
-void log_block(FILE *logfile, unsigned long block, unsigned long sector_offset,
-               size_t block_size __attribute__((unused)), int sectors_per_block,
-               long elapsed, const char *status) {
-    time_t now = time(NULL);
-    struct tm *t = localtime(&now);
-    char timestamp[20];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", t);
+// 解析百分比参数
+unsigned long parse_percentage(const char *str, unsigned long total_sectors) {
+    char *endptr;
+    double percent = strtod(str, &endptr);
 
-    unsigned long start_sector = block * sectors_per_block + sector_offset;
+    if (*endptr == '%' && percent >= 0 && percent <= 100) {
+        return (unsigned long)(percent / 100.0 * total_sectors);
+    }
 
-    // 只记录第一个扇区，添加块大小信息
-    fprintf(logfile, "%lu # %s # %ld ms # %s # %d sectors\n",
-            start_sector, timestamp, elapsed, status, sectors_per_block);
+    fprintf(stderr, "错误: 无效的百分比参数 '%s'\n", str);
 
-    fflush(logfile);
+    exit(1);
 }
 
-// 打印进度报告
-void print_progress_report(unsigned long current, unsigned long total,
-                           TimeCategory *cats, int cat_count,
-                           struct timespec *start_time) {
-    struct timespec now;
-    clock_gettime(CLOCK_MONOTONIC, &now);
+// 随机数发生器：xoshiro256**，每个采样迭代器一份状态，可由种子完全复现
+uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
 
-    double progress = (total > 0) ? 100.0 * current / total : 0.0;
-    double elapsed_sec = (now.tv_sec - start_time->tv_sec) +
-                        (now.tv_nsec - start_time->tv_nsec) / 1000000000.0;
-    double speed = (elapsed_sec > 0) ? current / elapsed_sec : 0;
-    double remaining_sec = (speed > 0 && current < total) ? (total - current) / speed : 0;
+uint64_t rng_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
 
-    printf("\r进度: %5.1f%% | 速度: %5.0f 块/秒 | 剩余: %dh%02dm%02ds | ",
-           progress, speed,
-           (int)(remaining_sec / 3600), (int)(remaining_sec) % 3600 / 60, (int)remaining_sec % 60);
+uint64_t rng_next(uint64_t s[4]) {
+    uint64_t result = rng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
 
-    for (int i = 0; i < cat_count; i++) {
-        if (cats[i].count > 0) {
-            printf("%s%s\033[0m: %lu ", cats[i].color, cats[i].name, cats[i].count);
-        } else {
-            printf("%s: %lu ", cats[i].name, cats[i].count);
-        }
-    }
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rng_rotl(s[3], 45);
 
-    fflush(stdout);
+    return result;
 }
 
-// 解析百分比参数
-unsigned long parse_percentage(const char *str, unsigned long total_sectors) {
-    char *endptr;
-    double percent = strtod(str, &endptr);
+// 用种子初始化状态，再前进 stream * 2^128 步，使各线程的随机序列互不重叠
+void rng_seed(uint64_t s[4], uint64_t seed, int stream) {
+    static const uint64_t jump[] = {
+        0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+    };
 
-    if (*endptr == '%' && percent >= 0 && percent <= 100) {
-        return (unsigned long)(percent / 100.0 * total_sectors);
+    for (int i = 0; i < 4; i++) {
+        s[i] = splitmix64(&seed);
     }
 
-    fprintf(stderr, "错误: 无效的百分比参数 '%s'\n", str);
+    for (int n = 0; n < stream; n++) {
+        uint64_t t[4] = { 0, 0, 0, 0 };
+        for (int i = 0; i < 4; i++) {
+            for (int b = 0; b < 64; b++) {
+                if (jump[i] & (1ULL << b)) {
+                    for (int j = 0; j < 4; j++) t[j] ^= s[j];
+                }
+                rng_next(s);
+            }
+        }
+        memcpy(s, t, sizeof(t));
+    }
+}
 
-    exit(1);
+// [0, bound) 内均匀分布的随机数（Lemire 乘法取高位，拒绝少量低位以消除偏差）
+uint64_t rng_below(uint64_t s[4], uint64_t bound) {
+    __uint128_t m = (__uint128_t)rng_next(s) * bound;
+    uint64_t low = (uint64_t)m;
+    if (low < bound) {
+        uint64_t threshold = -bound % bound;
+        while (low < threshold) {
+            m = (__uint128_t)rng_next(s) * bound;
+            low = (uint64_t)m;
+        }
+    }
+    return (uint64_t)(m >> 64);
 }
 
+// 自适应加密采样的区域：在 [first, last] 内按 stride 取样，位置都是 stride 的整数倍
+typedef struct {
+    unsigned long   first;
+    unsigned long   last;
+    unsigned long   next;               // 下一个要取的位置
+    unsigned long   stride;             // 2 的幂
+    unsigned long   origin;             // 触发加密的慢块，已经读过，不再重复读取
+} RefineRegion;
+
 // 采样迭代器
 typedef struct {
     unsigned long   total_blocks;
@@ -159,10 +534,66 @@ typedef struct {
     unsigned long   total_samples;
     double          sample_ratio;
     int             random_sampling;    // 0=均匀采样, 1=随机采样
+    uint64_t        rng[4];             // 随机采样的发生器状态
     double          step;               // 均匀采样步长
     unsigned long   last_block;         // 上次返回的块号
+    unsigned long   planned_samples;    // 按比例计划的样本数（时间预算只会减少样本数）
+    unsigned long   base_index;         // 均匀采样从 base_index 个样本起以 step 为步长，
+    double          base_block;         // 从 base_block 开始（调整样本数时重新设置）
+    // 覆盖位图模式：只在本轮尚未覆盖的块中均匀（或随机）采样
+    const unsigned char *coverage;      // 非 NULL 时启用，位为 1 表示本轮已覆盖
+    unsigned long   coverage_base;      // 本迭代器第 0 块在位图中的位置
+    unsigned long   uncovered;          // 初始化时尚未覆盖的块数
+    unsigned long   cursor;             // 已检查到的块号
+    unsigned long   cursor_rank;        // cursor 之前尚未覆盖的块数
+    unsigned long   rank_base_index;    // 调整样本数后，从第 rank_base_index 个样本、
+    unsigned long   rank_base;          // 第 rank_base 个未覆盖块起重新均分
+    // 低差异序列模式：按 van der Corput 序列（块号位反转）的顺序采样，
+    // 每 2^window_bits 个样本为一个窗口，窗口内按块号排序
+    int             low_discrepancy;
+    int             ldc_bits;           // 2^ldc_bits >= total_blocks
+    int             ldc_window_bits;
+    unsigned long   ldc_window;         // 当前窗口序号
+    unsigned long   ldc_offset;         // 当前窗口内的下标
+    unsigned long   ldc_mask;           // 随机采样时对序列做的随机异或扰动
+    // 自适应加密采样：慢块附近的区域优先于稀疏采样，后加入的区域先扫描
+    int             refine;             // 1=启用
+    int             refine_count;       // 栈中尚未扫描完的区域数
+    unsigned long   refine_remaining;   // 栈中区域尚未取出的样本数
+    unsigned long   refine_scheduled;   // 累计安排的加密样本数
+    RefineRegion    refine_stack[REFINE_MAX_REGIONS];
+    RefineRegion    refine_done[REFINE_DONE_REGIONS];   // 最近扫描完的区域（环形）
+    int             refine_done_head;
 } SampleIterator;
 
+// 覆盖位图中第 block 块是否已覆盖
+int coverage_test(const unsigned char *bits, unsigned long block) {
+    return (__atomic_load_n(&bits[block >> 3], __ATOMIC_RELAXED) >> (block & 7)) & 1;
+}
+
+// 标记第 block 块已覆盖，多个线程可能同时修改同一字节
+void coverage_mark(unsigned char *bits, unsigned long block) {
+    __atomic_fetch_or(&bits[block >> 3], (unsigned char)(1 << (block & 7)), __ATOMIC_RELAXED);
+}
+
+// 统计 [base, base + count) 范围内已覆盖的块数
+unsigned long coverage_count(const unsigned char *bits, unsigned long base, unsigned long count) {
+    unsigned long covered = 0;
+    unsigned long block = base, end = base + count;
+
+    while (block < end && (block & 7) != 0) {
+        covered += coverage_test(bits, block++);
+    }
+    while (block + 8 <= end) {
+        covered += __builtin_popcount(__atomic_load_n(&bits[block >> 3], __ATOMIC_RELAXED));
+        block += 8;
+    }
+    while (block < end) {
+        covered += coverage_test(bits, block++);
+    }
+    return covered;
+}
+
 // 初始化采样迭代器
 int init_sample_iterator(SampleIterator *iter, unsigned long total_blocks,
                         double sample_ratio, int random_sampling) {
@@ -171,153 +602,416 @@ int init_sample_iterator(SampleIterator *iter, unsigned long total_blocks,
     iter->sample_ratio = sample_ratio;
     iter->random_sampling = random_sampling;
     iter->last_block = 0;
+    iter->coverage = NULL;
+    iter->low_discrepancy = 0;
+    iter->refine = 0;
+    iter->refine_count = 0;
+    iter->refine_remaining = 0;
+    iter->refine_scheduled = 0;
+    iter->refine_done_head = 0;
+    memset(iter->refine_done, 0, sizeof(iter->refine_done));
 
     iter->total_samples = (unsigned long)(total_blocks * sample_ratio / 100.0);
     if (iter->total_samples == 0) iter->total_samples = 1;
     if (iter->total_samples > total_blocks) iter->total_samples = total_blocks;
+    iter->planned_samples = iter->total_samples;
+    iter->base_index = 0;
+    iter->base_block = 0;
 
-    if (random_sampling) {
-        srand(time(NULL)); // 初始化随机数种子
-    } else {
+    // 随机采样的发生器由调用方用 rng_seed() 初始化
+    memset(iter->rng, 0, sizeof(iter->rng));
+    if (!random_sampling) {
         iter->step = (double)total_blocks / iter->total_samples;
     }
 
     return 0;
 }
 
-// 获取下一个采样块号，返回-1表示结束
-long get_next_sample_block(SampleIterator *iter) {
-    if (iter->current_index >= iter->total_samples) {
-        return -1; // 采样结束
+// 把 value 的低 bits 位反转
+unsigned long bit_reverse(unsigned long value, int bits) {
+    unsigned long result = 0;
+    for (int i = 0; i < bits; i++) {
+        result = (result << 1) | ((value >> i) & 1);
     }
+    return result;
+}
 
-    unsigned long block_num;
-
-    if (iter->random_sampling) {
-        // 随机采样：在剩余空间中随机选择
-        unsigned long remaining_blocks = iter->total_blocks - iter->last_block;
-        unsigned long remaining_samples = iter->total_samples - iter->current_index;
+// 切换到低差异序列顺序：样本集合与比例不变，但任意前缀都近似均匀地分布在整个范围内，
+// 扫描中途停止也能得到有代表性的结果。window 为窗口块数（向下取整到 2 的幂），
+// 机械硬盘使用较大的窗口，窗口内按块号顺序读取以减少寻道
+void sample_iterator_use_ldc(SampleIterator *iter, unsigned long window) {
+    int bits = 0;
+    while ((1UL << bits) < iter->total_blocks) bits++;
+    int window_bits = 0;
+    while (window_bits < bits && (2UL << window_bits) <= window) window_bits++;
+
+    iter->low_discrepancy = 1;
+    iter->ldc_bits = bits;
+    iter->ldc_window_bits = window_bits;
+    iter->ldc_window = 0;
+    iter->ldc_offset = 0;
+    // 对位反转后的值异或同一个掩码仍是低差异序列（随机数字扰动）
+    iter->ldc_mask = iter->random_sampling ? rng_next(iter->rng) & ((1UL << bits) - 1) : 0;
+}
 
-        if (remaining_samples >= remaining_blocks) {
-            block_num = iter->last_block;
-        } else {
-            // 计算平均间隔，然后在间隔内随机选择
-            double avg_gap = (double)remaining_blocks / remaining_samples;
-            unsigned long max_gap = (unsigned long)(avg_gap * 2);
-            if (max_gap < 1) max_gap = 1;
-            unsigned long gap = 1 + (rand() % max_gap);
-            block_num = iter->last_block + gap;
-            if (block_num >= iter->total_blocks) {
-                block_num = iter->total_blocks - 1;
+// 低差异序列模式：第 i 个值为 i 的位反转。i = j*2^m + t 时，位反转值为
+// rev(t)*2^(n-m) + rev(j)，因此第 j 个窗口排序后是首项 rev(j)、公差 2^(n-m) 的等差数列，
+// 只需记录窗口序号和窗口内下标。超出范围的值直接跳过
+long get_next_ldc_block(SampleIterator *iter) {
+    int stride_bits = iter->ldc_bits - iter->ldc_window_bits;
+    unsigned long window_size = 1UL << iter->ldc_window_bits;
+    unsigned long stride = 1UL << stride_bits;
+
+    while (iter->ldc_window < stride) {
+        unsigned long first = bit_reverse(iter->ldc_window, stride_bits) ^ (iter->ldc_mask & (stride - 1));
+        if (iter->ldc_offset < window_size) {
+            unsigned long block = first + iter->ldc_offset * stride;
+            if (block < iter->total_blocks) {
+                iter->ldc_offset++;
+                iter->last_block = block;
+                iter->current_index++;
+                return (long)block;
             }
         }
-    } else {
-        // 均匀采样
-        block_num = (unsigned long)(iter->current_index * iter->step);
-        if (block_num >= iter->total_blocks) {
-            block_num = iter->total_blocks - 1;
-        }
+        // 窗口内其余的值都超出范围
+        iter->ldc_window++;
+        iter->ldc_offset = 0;
     }
 
-    iter->last_block = block_num;
-    iter->current_index++;
+    return -1;
+}
 
-    return (long)block_num;
+// 初始化覆盖位图模式的采样迭代器：样本数按比例计算，但不超过本轮尚未覆盖的块数，
+// 因此每天扫描 5% 时，二十次运行恰好把整个范围覆盖一遍
+int init_coverage_iterator(SampleIterator *iter, unsigned long total_blocks,
+                           double sample_ratio, int random_sampling,
+                           const unsigned char *coverage, unsigned long coverage_base) {
+    init_sample_iterator(iter, total_blocks, sample_ratio, random_sampling);
+
+    iter->coverage = coverage;
+    iter->coverage_base = coverage_base;
+    iter->uncovered = total_blocks - coverage_count(coverage, coverage_base, total_blocks);
+    iter->cursor = 0;
+    iter->cursor_rank = 0;
+    iter->rank_base_index = 0;
+    iter->rank_base = 0;
+    // 向上取整，保证 100/比例 次运行一定能覆盖完
+    iter->total_samples = (unsigned long)ceil(total_blocks * sample_ratio / 100.0);
+    if (iter->total_samples > iter->uncovered) iter->total_samples = iter->uncovered;
+    iter->planned_samples = iter->total_samples;
+
+    return 0;
 }
 
-// 生成抽样块列表
-unsigned long* generate_sample_blocks(unsigned long total_blocks, double sample_ratio, unsigned long *sample_count) {
-    *sample_count = (unsigned long)(total_blocks * sample_ratio / 100.0);
-    if (*sample_count == 0) *sample_count = 1;
-    if (*sample_count > total_blocks) *sample_count = total_blocks;
+// 覆盖位图模式：第 k 个样本取尚未覆盖的块中第 floor(k*U/S) 个，
+// 随机采样时在 [floor(k*U/S), floor((k+1)*U/S)) 内随机选择。
+// 调整过样本数时，剩余样本在剩余的未覆盖块中重新均分
+long get_next_coverage_block(SampleIterator *iter) {
+    unsigned long k = iter->current_index - iter->rank_base_index;
+    double spacing = (double)(iter->uncovered - iter->rank_base) /
+                     (iter->total_samples - iter->rank_base_index);
+    unsigned long rank = iter->rank_base + (unsigned long)(k * spacing);
+    if (iter->random_sampling) {
+        unsigned long next = iter->rank_base + (unsigned long)((k + 1) * spacing);
+        if (next > rank + 1) rank += rng_below(iter->rng, next - rank);
+    }
 
-    unsigned long *sample_blocks = malloc(*sample_count * sizeof(unsigned long));
-    if (!sample_blocks) return NULL;
+    while (iter->cursor < iter->total_blocks) {
+        unsigned long pos = iter->coverage_base + iter->cursor;
 
-    if (sample_ratio >= 100.0) {
-        // 100%采样，顺序扫描
-        for (unsigned long i = 0; i < *sample_count; i++) {
-            sample_blocks[i] = i;
+        // 整字节都已覆盖时一次跳过 8 块
+        if ((pos & 7) == 0 && iter->cursor + 8 <= iter->total_blocks &&
+            __atomic_load_n(&iter->coverage[pos >> 3], __ATOMIC_RELAXED) == 0xff) {
+            iter->cursor += 8;
+            continue;
         }
-    } else {
-        // 按比例均匀采样
-        double step = (double)total_blocks / *sample_count;
-        for (unsigned long i = 0; i < *sample_count; i++) {
-            sample_blocks[i] = (unsigned long)(i * step);
+
+        iter->cursor++;
+        if (coverage_test(iter->coverage, pos)) continue;
+        if (iter->cursor_rank++ == rank) {
+            iter->last_block = iter->cursor - 1;
+            iter->current_index++;
+            return (long)iter->last_block;
         }
     }
 
-    return sample_blocks;
+    return -1;
 }
 
-// 可疑块重测函数
-long retest_suspect_block(int fd, void *buffer, size_t block_size,
-                          unsigned long block_num, int sectors_per_block,
-                          unsigned long sector_offset, int sector_size,
-                          int retries, int interval_ms) {
-    if (retries < 3) retries = 3; // 至少需要3次才能去掉最大最小值
+// 调整剩余的样本数（不少于已取出的样本数），剩余样本均匀分布在尚未经过的范围内。
+// 随机采样和低差异序列本身就按剩余量取样，只需修改总数
+void sample_iterator_retarget(SampleIterator *iter, unsigned long total_samples) {
+    if (total_samples < iter->current_index) total_samples = iter->current_index;
+    if (total_samples == iter->total_samples) return;
+
+    if (iter->coverage) {
+        iter->rank_base_index = iter->current_index;
+        iter->rank_base = iter->cursor_rank;
+    } else if (!iter->random_sampling && !iter->low_discrepancy) {
+        double start = iter->current_index > 0 ? iter->last_block + 1 : 0;
+        unsigned long remaining = total_samples - iter->current_index;
+        iter->base_index = iter->current_index;
+        iter->base_block = start;
+        if (remaining > 0) iter->step = (iter->total_blocks - start) / remaining;
+    }
 
-    long *results = malloc(retries * sizeof(long));
-    if (!results) return -1;
+    iter->total_samples = total_samples;
+}
 
-    struct timespec start, end;
-    off_t block_offset = (off_t)(block_num * sectors_per_block + sector_offset) * sector_size;
+// 区域中 next 及之后尚未取出的样本数
+unsigned long refine_region_pending(const RefineRegion *region) {
+    if (region->next > region->last) return 0;
+    unsigned long count = (region->last - region->next) / region->stride + 1;
+    if (region->origin >= region->next && region->origin <= region->last &&
+        region->origin % region->stride == 0) {
+        count--;
+    }
+    return count;
+}
 
-    int valid_count = 0;
-    for (int i = 0; i < retries; i++) {
-        // 强制停顿
-        if (interval_ms > 0) {
-            struct timespec sleep_time = {
-                .tv_sec = interval_ms / 1000,
-                .tv_nsec = (interval_ms % 1000) * 1000000
-            };
-            nanosleep(&sleep_time, NULL);
+// 查找包含 block 的最细的加密区域（正在扫描或最近扫描完的），找不到返回 NULL
+const RefineRegion *refine_find_region(const SampleIterator *iter, unsigned long block) {
+    const RefineRegion *found = NULL;
+    for (int i = 0; i < REFINE_MAX_REGIONS + REFINE_DONE_REGIONS; i++) {
+        const RefineRegion *region = i < REFINE_MAX_REGIONS ? &iter->refine_stack[i]
+                                                            : &iter->refine_done[i - REFINE_MAX_REGIONS];
+        if (i < REFINE_MAX_REGIONS && i >= iter->refine_count) continue;
+        if (region->stride == 0 || block < region->first || block > region->last ||
+            block % region->stride != 0) {
+            continue;
         }
+        if (!found || region->stride < found->stride) found = region;
+    }
+    return found;
+}
 
-        // 重新定位
-        if (lseek(fd, block_offset, SEEK_SET) != block_offset) {
+// 区域已取完，留在最近完成的记录中，用于判断之后完成的慢块来自哪一级以及避免重复读取。
+// 与相邻的同步长区域合并，沿损坏区域逐段延伸时只占一条记录
+void refine_retire(SampleIterator *iter, const RefineRegion *region) {
+    for (int i = 0; i < REFINE_DONE_REGIONS; i++) {
+        RefineRegion *done = &iter->refine_done[i];
+        if (done->stride != region->stride) continue;
+        if (done->last + done->stride < region->first || region->last + region->stride < done->first) {
             continue;
         }
+        if (region->first < done->first) done->first = region->first;
+        if (region->last > done->last) done->last = region->last;
+        done->next = done->last + done->stride;
+        return;
+    }
 
-        clock_gettime(CLOCK_MONOTONIC, &start);
-        ssize_t bytes_read = read(fd, buffer, block_size);
-        clock_gettime(CLOCK_MONOTONIC, &end);
+    iter->refine_done[iter->refine_done_head] = *region;
+    iter->refine_done_head = (iter->refine_done_head + 1) % REFINE_DONE_REGIONS;
+}
 
-        if (bytes_read != (ssize_t)block_size) {
-            free(results);
-            return -1; // 读取失败
+// 把区域裁掉与已有同步长区域重叠的部分后压栈，返回加入的样本数
+unsigned long refine_push(SampleIterator *iter, RefineRegion region) {
+    // 刚取完最后一个样本的区域还留在栈中，沿损坏区域延伸时会越积越多，先移出
+    int kept = 0;
+    for (int i = 0; i < iter->refine_count; i++) {
+        if (iter->refine_stack[i].next > iter->refine_stack[i].last) {
+            refine_retire(iter, &iter->refine_stack[i]);
+        } else {
+            iter->refine_stack[kept++] = iter->refine_stack[i];
+        }
+    }
+    iter->refine_count = kept;
+
+    for (int i = 0; i < REFINE_MAX_REGIONS + REFINE_DONE_REGIONS; i++) {
+        const RefineRegion *other = i < REFINE_MAX_REGIONS ? &iter->refine_stack[i]
+                                                           : &iter->refine_done[i - REFINE_MAX_REGIONS];
+        if (i < REFINE_MAX_REGIONS && i >= iter->refine_count) continue;
+        if (other->stride != region.stride) continue;
+        if (region.first >= other->first && region.first <= other->last) {
+            region.first = other->last + region.stride;
+        }
+        if (region.last >= other->first && region.last <= other->last) {
+            if (other->first < region.stride) return 0;
+            region.last = other->first - region.stride;
         }
+        if (region.first > region.last) return 0;
+    }
+
+    if (iter->refine_count >= REFINE_MAX_REGIONS) return 0;
+    region.next = region.first;
+    unsigned long count = refine_region_pending(&region);
+    // 加密读取的总数不超过范围内的块数，保证记录被挤出后重复覆盖也一定会结束
+    if (count == 0 || iter->refine_scheduled + count > iter->total_blocks) return 0;
 
-        long elapsed = (end.tv_sec - start.tv_sec) * 1000 +
-                      (end.tv_nsec - start.tv_nsec) / 1000000;
+    iter->refine_stack[iter->refine_count++] = region;
+    iter->refine_remaining += count;
+    iter->refine_scheduled += count;
+    return count;
+}
 
-        results[valid_count++] = elapsed;
+// block 读取偏慢或失败时在它附近安排更密的采样，返回新增的区域数，*samples 为新增的样本数。
+// 稀疏采样命中的慢块，在与相邻样本之间的范围内以 1/REFINE_FACTOR 的间距加密；
+// 加密样本再次命中时继续细分，直到逐块扫描。慢块位于区域边缘时，同一间距向外延伸，
+// 从而逐步找出整片损坏区域的范围
+int sample_iterator_refine(SampleIterator *iter, unsigned long block, unsigned long *samples) {
+    *samples = 0;
+    if (!iter->refine || block >= iter->total_blocks) return 0;
+
+    const RefineRegion *found = refine_find_region(iter, block);
+    unsigned long spacing = found ? found->stride
+                                  : (unsigned long)ceil((double)iter->total_blocks / iter->planned_samples);
+    int regions = 0;
+    unsigned long added;
+
+    if (found && (block == found->first || block == found->last)) {
+        unsigned long reach = 2 * REFINE_FACTOR * spacing;
+        RefineRegion extend = { .stride = spacing, .origin = block };
+        if (block == found->last) {
+            extend.first = block + spacing;
+            extend.last = block + reach;
+            if (extend.last >= iter->total_blocks) {
+                extend.last = (iter->total_blocks - 1) / spacing * spacing;
+            }
+        } else if (block > 0) {
+            extend.first = block >= reach ? block - reach : 0;
+            extend.last = block - spacing;
+        } else {
+            extend.first = 1;   // 已到达范围起点，无需延伸
+            extend.last = 0;
+        }
+        if (extend.first <= extend.last && (added = refine_push(iter, extend)) > 0) {
+            *samples += added;
+            regions++;
+        }
     }
 
-    if (valid_count < 3) {
-        free(results);
-        return -1; // 重测失败次数太多
+    if (spacing > 1) {
+        unsigned long stride = 1;
+        while (stride * 2 * REFINE_FACTOR <= spacing) stride *= 2;
+
+        // 不含两侧的相邻样本
+        RefineRegion child = { .stride = stride, .origin = block };
+        child.first = block >= spacing - 1 ? block - (spacing - 1) : 0;
+        child.first = (child.first + stride - 1) / stride * stride;
+        child.last = block + (spacing - 1);
+        if (child.last >= iter->total_blocks) child.last = iter->total_blocks - 1;
+        child.last = child.last / stride * stride;
+        if (child.first <= child.last && (added = refine_push(iter, child)) > 0) {
+            *samples += added;
+            regions++;
+        }
     }
 
-    // 找出最大值和最小值，无需排序
-    long min_val = results[0];
-    long max_val = results[0];
-    long sum = 0;
+    return regions;
+}
 
-    for (int i = 1; i < valid_count; i++) {
-        if (results[i] < min_val) min_val = results[i];
-        if (results[i] > max_val) max_val = results[i];
-        sum += results[i];
+// block 是否已被其他加密区域读过（不同步长的区域会有重叠的位置，也包括触发加密的慢块）
+int refine_already_read(const SampleIterator *iter, const RefineRegion *current, unsigned long block) {
+    for (int i = 0; i < REFINE_MAX_REGIONS + REFINE_DONE_REGIONS; i++) {
+        const RefineRegion *region = i < REFINE_MAX_REGIONS ? &iter->refine_stack[i]
+                                                            : &iter->refine_done[i - REFINE_MAX_REGIONS];
+        if (i < REFINE_MAX_REGIONS && i >= iter->refine_count) continue;
+        if (region == current || region->stride == 0) continue;
+        if (block == region->origin) return 1;
+        if (block >= region->first && block < region->next && block % region->stride == 0) return 1;
     }
+    return iter->coverage && coverage_test(iter->coverage, iter->coverage_base + block);
+}
 
-    // 如果样本数大于2，去掉最大最小值
-    if (valid_count > 2) {
-        sum = sum - min_val - max_val;
-        valid_count -= 2;
+// 取出加密区域中的下一个块，没有时返回 -1
+long get_next_refine_block(SampleIterator *iter) {
+    while (iter->refine_count > 0) {
+        RefineRegion *region = &iter->refine_stack[iter->refine_count - 1];
+        while (region->next <= region->last) {
+            unsigned long block = region->next;
+            region->next += region->stride;
+            if (block == region->origin || block >= iter->total_blocks) continue;
+            if (refine_already_read(iter, region, block)) {
+                iter->refine_remaining--;
+                continue;
+            }
+            iter->refine_remaining--;
+            return (long)block;
+        }
+
+        refine_retire(iter, region);
+        iter->refine_count--;
+    }
+    return -1;
+}
+
+// 放弃尚未扫描的加密区域
+void sample_iterator_drop_refine(SampleIterator *iter) {
+    iter->refine_count = 0;
+    iter->refine_remaining = 0;
+}
+
+// 尚未取出的样本数（含加密区域），多线程引擎的进度线程会在工作线程推进时读取
+unsigned long sample_iterator_remaining(const SampleIterator *iter) {
+    unsigned long taken = __atomic_load_n(&iter->current_index, __ATOMIC_ACQUIRE);
+    unsigned long samples = __atomic_load_n(&iter->total_samples, __ATOMIC_ACQUIRE);
+    return (samples > taken ? samples - taken : 0) +
+           __atomic_load_n(&iter->refine_remaining, __ATOMIC_RELAXED);
+}
+
+// 获取下一个采样块号，返回-1表示结束
+long get_next_sample_block(SampleIterator *iter) {
+    if (iter->refine_count > 0) {
+        long block = get_next_refine_block(iter);
+        if (block >= 0) return block;
     }
 
-    free(results);
-    return sum / valid_count;
+    if (iter->current_index >= iter->total_samples) {
+        return -1; // 采样结束
+    }
+
+    if (iter->coverage) {
+        return get_next_coverage_block(iter);
+    }
+    if (iter->low_discrepancy) {
+        return get_next_ldc_block(iter);
+    }
+
+    unsigned long block_num;
+
+    if (iter->random_sampling) {
+        // 随机采样：在剩余空间中随机选择
+        unsigned long remaining_blocks = iter->total_blocks - iter->last_block;
+        unsigned long remaining_samples = iter->total_samples - iter->current_index;
+
+        if (remaining_samples >= remaining_blocks) {
+            block_num = iter->last_block;
+        } else {
+            // 计算平均间隔，然后在间隔内随机选择
+            double avg_gap = (double)remaining_blocks / remaining_samples;
+            unsigned long max_gap = (unsigned long)(avg_gap * 2);
+            if (max_gap < 1) max_gap = 1;
+            unsigned long gap = 1 + rng_below(iter->rng, max_gap);
+            block_num = iter->last_block + gap;
+            if (block_num >= iter->total_blocks) {
+                block_num = iter->total_blocks - 1;
+            }
+        }
+    } else {
+        // 均匀采样
+        block_num = (unsigned long)(iter->base_block + (iter->current_index - iter->base_index) * iter->step);
+        if (block_num >= iter->total_blocks) {
+            block_num = iter->total_blocks - 1;
+        }
+    }
+
+    iter->last_block = block_num;
+    iter->current_index++;
+
+    return (long)block_num;
+}
+
+// 批量取出接下来最多 max_count 个采样块号，写入调用方提供的数组，返回实际取出的个数。
+// 只推进迭代器自身的状态，内存占用与设备大小无关。返回 0 表示暂时没有样本：
+// 加密采样可能在之后完成的读取中追加新的区域，异步引擎应在在途请求全部完成后再结束
+size_t sample_iterator_next_batch(SampleIterator *iter, unsigned long *blocks, size_t max_count) {
+    size_t count = 0;
+    while (count < max_count) {
+        long block = get_next_sample_block(iter);
+        if (block == -1) break;
+        blocks[count++] = (unsigned long)block;
+    }
+    return count;
 }
 
 typedef struct {
@@ -326,14 +1020,45 @@ typedef struct {
     const char *end_str;
     size_t      block_size;
     const char *log_filename;
-    int         log_threshold;
+    long        log_threshold;      // 微秒
     const char *config_file;
     double      sample_ratio;
     int         random_sampling;
     int         wait_factor;
-    int         suspect_threshold;
+    long        suspect_threshold;  // 微秒
     int         suspect_retries;
     int         suspect_interval;
+    ScanEngine  engine;
+    int         queue_depth;        // 0 表示自动：有该型号的基准测试结果时用推荐值，否则为默认值
+    int         threads;            // 0 表示根据设备自动选择
+    size_t      fine_block_size;    // 分层扫描细分到的最小块大小，0 表示不启用
+    int         async_retest;       // 1=可疑块由后台线程异步重测
+    int         adaptive_retest;    // 1=重测样本足以判定快慢时提前停止，-R 为上限
+    const char *latency_map_file;   // 每块 1 字节的延迟图文件
+    const char *binlog_file;        // 二进制日志文件，可用 log 子命令转换为文本
+    const char *json_file;          // JSON 格式的最终报告
+    const char *events_target;      // NDJSON 事件流：文件路径或已打开的文件描述符号
+    int         top_ranges;         // 报告中列出的最严重区间数，0 表示未指定
+    const char *ranges_file;        // 导出合并后的慢块/坏块区间
+    const char *badblocks_file;     // 导出 e2fsck -l / badblocks -o 格式的坏块列表
+    size_t      fs_block_size;      // 坏块列表使用的文件系统块大小
+    const char *heatmap_file;       // LBA × 延迟热力图，按扩展名输出 CSV/JSON/PGM，"-" 表示只在报告中显示
+    const char *profile_file;       // 吞吐曲线模式：按扩展名输出 CSV/JSON，"-" 表示只在屏幕上显示
+    int         profile_windows;    // 吞吐曲线的窗口数
+    const char *coverage_file;      // 覆盖位图文件，重复抽样扫描时优先扫描未覆盖的块
+    int         low_discrepancy;    // 1=按低差异序列顺序采样
+    unsigned long ldc_window;       // 低差异序列的排序窗口块数，0 表示根据设备类型选择
+    const char *checkpoint_file;    // 断点文件，NULL 表示不保存断点
+    int         checkpoint_interval;    // 秒
+    int         resume;             // 1=从断点文件继续上次的扫描
+    long        time_budget;        // 时间预算（秒），0 表示不限制
+    int         refine;             // 1=抽样扫描时在慢块附近自适应加密采样
+    uint64_t    seed;               // 随机采样的种子，未指定时按时间生成
+    int         calibrate;          // 1=扫描前测量转速和寻道时间，用于自动分类阈值
+    long        bench_cell_us;      // 基准测试每个组合的测量时长
+    long        bench_ceiling;      // 基准测试的 p99 延迟上限（微秒），0 表示使用可疑块阈值
+    const char *bench_db;           // 基准测试结果文件，NULL 表示 $HOME 下的默认文件
+    int         rotational;         // 1=机械硬盘，剩余时间按外圈到内圈的速度曲线外推
 } ScanOptions;
 
 // 解析命令行参数
@@ -344,7 +1069,7 @@ int parse_arguments(int argc, char *argv[], ScanOptions *opts) {
     opts->end_str           = NULL;
     opts->block_size        = BLOCK_SIZE_DEFAULT;
     opts->log_filename      = NULL;
-    opts->log_threshold     = 100;      // 默认日志阈值为 100ms
+    opts->log_threshold     = DEFAULT_LOG_THRESHOLD;
     opts->config_file       = NULL;
     opts->sample_ratio      = 100.0;    // 默认 100% 采样
     opts->random_sampling   = 0;        // 默认均匀采样
@@ -352,25 +1077,96 @@ int parse_arguments(int argc, char *argv[], ScanOptions *opts) {
     opts->suspect_threshold = DEFAULT_SUSPECT_THRESHOLD;
     opts->suspect_retries   = DEFAULT_SUSPECT_RETRIES;
     opts->suspect_interval  = DEFAULT_SUSPECT_INTERVAL;
+    opts->engine            = ENGINE_SYNC;
+    opts->queue_depth       = 0;
+    opts->threads           = 0;
+    opts->fine_block_size   = 0;
+    opts->async_retest      = 0;
+    opts->adaptive_retest   = 0;
+    opts->latency_map_file  = NULL;
+    opts->binlog_file       = NULL;
+    opts->json_file         = NULL;
+    opts->events_target     = NULL;
+    opts->top_ranges        = 0;
+    opts->ranges_file       = NULL;
+    opts->badblocks_file    = NULL;
+    opts->fs_block_size     = DEFAULT_FS_BLOCK_SIZE;
+    opts->heatmap_file      = NULL;
+    opts->profile_file      = NULL;
+    opts->profile_windows   = PROFILE_DEFAULT_WINDOWS;
+    opts->coverage_file     = NULL;
+    opts->low_discrepancy   = 0;
+    opts->ldc_window        = 0;
+    opts->checkpoint_file   = NULL;
+    opts->checkpoint_interval = DEFAULT_CHECKPOINT_INTERVAL;
+    opts->resume            = 0;
+    opts->time_budget       = 0;
+    opts->refine            = 0;
+    opts->calibrate         = 0;
+    opts->bench_cell_us     = DEFAULT_BENCH_CELL_US;
+    opts->bench_ceiling     = 0;
+    opts->bench_db          = NULL;
+    opts->rotational        = 0;
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    uint64_t entropy = ((uint64_t)now.tv_sec << 32) ^ (uint64_t)now.tv_nsec ^ ((uint64_t)getpid() << 16);
+    opts->seed              = splitmix64(&entropy);
 
     if (argc < 4) {
         fprintf(stderr, "用法: %s <设备> <起始扇区> <结束扇区> [选项]\n", argv[0]);
         fprintf(stderr, "选项:\n");
         fprintf(stderr, "  -b <块大小>     块大小（字节数，默认 512）\n");
         fprintf(stderr, "  -l <日志文件>   日志文件\n");
-        fprintf(stderr, "  -L <日志阈值>   记录到日志的阈值，默认为 100ms\n");
+        fprintf(stderr, "  --binlog <文件> 以紧凑的二进制格式记录慢块和错误（阈值同 -L），可用 log 子命令转换为文本\n");
+        fprintf(stderr, "  --json <文件>   把最终报告以 JSON 格式写入文件\n");
+        fprintf(stderr, "  --events <fd|文件> 以 NDJSON 格式输出进度和慢块/错误事件（数字表示已打开的文件描述符）\n");
+        fprintf(stderr, "  --top <N>       报告中列出最严重的 N 个慢块/坏块区间（默认 %d，指定即启用区间合并）\n", DEFAULT_TOP_RANGES);
+        fprintf(stderr, "  --ranges <文件> 导出合并后的慢块/坏块区间列表\n");
+        fprintf(stderr, "  --badblocks <文件> 导出坏块列表，可直接用于 e2fsck -l / mke2fs -l\n");
+        fprintf(stderr, "  --fs-block-size <字节> 坏块列表使用的文件系统块大小（默认 %d）\n", DEFAULT_FS_BLOCK_SIZE);
+        fprintf(stderr, "  --heatmap <文件> 保存 LBA × 延迟热力图（扩展名 .csv/.json/.pgm，- 表示只在报告中显示）\n");
+        fprintf(stderr, "  --profile <文件> 吞吐曲线模式：以大块顺序读取测量各位置的 MB/s 并检测凹陷（扩展名 .csv/.json，- 表示只显示）\n");
+        fprintf(stderr, "  --profile-windows <N> 吞吐曲线的窗口数（默认 %d）\n", PROFILE_DEFAULT_WINDOWS);
+        fprintf(stderr, "  -M <延迟图文件> 记录每块的量化延迟（每块 1 字节），可用 map 子命令查看\n");
+        fprintf(stderr, "  -L <日志阈值>   记录到日志的阈值（可带 us/ms/s 单位，默认 100ms）\n");
         fprintf(stderr, "  -c <配置文件>   时间分类配置文件\n");
         fprintf(stderr, "  -s <百分比>     抽样检查百分比（如 10 表示 10%%，默认 100%%）\n");
         fprintf(stderr, "  -r              启用随机采样（默认均匀采样）\n");
+        fprintf(stderr, "  --seed <种子>   随机采样的种子，用报告中的种子可以完全复现一次扫描（默认按时间生成）\n");
+        fprintf(stderr, "  --coverage <文件> 覆盖位图：多次抽样扫描优先检查尚未扫描过的块，直至覆盖全盘\n");
+        fprintf(stderr, "  --low-discrepancy 按低差异序列顺序采样，扫描的任意前缀都均匀分布在整个范围\n");
+        fprintf(stderr, "  --refine        抽样扫描命中慢块或错误时，在其附近逐级加密采样直至逐块扫描，找出整片损坏区域\n");
+        fprintf(stderr, "  --calibrate     扫描前用随机读取测量机械硬盘的转速和寻道时间，据此选择自动分类阈值（约 15 秒）\n");
+        fprintf(stderr, "  --bench-cell <时长> 基准测试每个组合的测量时长（默认 500ms）\n");
+        fprintf(stderr, "  --bench-ceiling <延迟> 基准测试推荐参数时的 p99 延迟上限（默认为可疑块阈值）\n");
+        fprintf(stderr, "  --bench-db <文件> 按型号保存基准测试推荐参数的文件（默认 ~/%s）\n", BENCH_DB_FILE);
+        fprintf(stderr, "  --time-budget <时长> 在限定时间内完成扫描，按实测速度降低抽样比例（如 30m、2h，缺省为秒）\n");
+        fprintf(stderr, "  --ldc-window <块数> 低差异序列每个窗口内按块号排序读取（默认 SSD 1，机械硬盘 %d）\n",
+                DEFAULT_LDC_WINDOW_HDD);
         fprintf(stderr, "  -w <因子>       等待时间因子（如 200 表示 200%%，默认 0 不等待）\n");
-        fprintf(stderr, "  -S <阈值>       可疑块阈值（ms，默认 100）\n");
+        fprintf(stderr, "  -S <阈值>       可疑块阈值（可带 us/ms/s 单位，缺省为 ms，默认 100ms）\n");
         fprintf(stderr, "  -R <次数>       可疑块重测次数（默认 10）\n");
-        fprintf(stderr, "  -I <间隔>       可疑块重测间隔（ms，默认 100）\n");
+        fprintf(stderr, "  -I <间隔>       可疑块每次重测前的额外停顿（ms，默认 0；重测已穿插远端读取）\n");
+        fprintf(stderr, "  -e <引擎>       读取引擎: sync（同步，默认）、uring（io_uring 异步）或 threads（多线程）\n");
+        fprintf(stderr, "  -q <队列深度>   io_uring 引擎的在途请求数（默认 %d）\n", DEFAULT_QUEUE_DEPTH);
+        fprintf(stderr, "  -t <线程数>     多线程引擎的线程数（默认根据设备类型自动选择）\n");
+        fprintf(stderr, "  -f <块大小>     分层扫描：慢/错误的大块二分定位到该粒度（字节，如 512）\n");
+        fprintf(stderr, "  --async-retest  可疑块放入队列由后台线程重测，主扫描不等待\n");
+        fprintf(stderr, "  --adaptive-retest 重测结果足以判定快慢时提前停止（-R 为最多次数）\n");
+        fprintf(stderr, "  --checkpoint <文件> 定期把扫描进度保存到断点文件，Ctrl-C 时也会保存\n");
+        fprintf(stderr, "  --checkpoint-interval <秒> 断点保存间隔（默认 %d 秒）\n", DEFAULT_CHECKPOINT_INTERVAL);
+        fprintf(stderr, "  --resume        从 --checkpoint 指定的断点文件继续上次的扫描\n");
         fprintf(stderr, "  --no-auto       禁用自动设备检测和配置\n");
+        fprintf(stderr, "\n查看延迟图: %s map <延迟图文件> [阈值]\n", argv[0]);
+        fprintf(stderr, "转换二进制日志: %s log <二进制日志文件>\n", argv[0]);
+        fprintf(stderr, "基准测试: %s bench <设备> <起始扇区> <结束扇区> [选项]\n", argv[0]);
         fprintf(stderr, "\n示例:\n");
         fprintf(stderr, "  %s /dev/sda 0 1000000\n", argv[0]);
         fprintf(stderr, "  %s /dev/sda \"97%%\" \"100%%\" -b 4096 -l scan.log -s 50\n", argv[0]);
         fprintf(stderr, "  %s /dev/sda 0 1000000 -c categories.conf -S 200 -R 5\n", argv[0]);
+        fprintf(stderr, "  %s /dev/nvme0n1 0 100%% -b 4096 -e uring -q 64\n", argv[0]);
+        fprintf(stderr, "  %s /dev/sda 0 100%% -b 1048576 -f 512\n", argv[0]);
         return 1;
     }
 
@@ -380,25 +1176,140 @@ int parse_arguments(int argc, char *argv[], ScanOptions *opts) {
             opts->block_size = atoi(argv[++i]);
         } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
             opts->log_filename = argv[++i];
+        } else if (strcmp(argv[i], "-M") == 0 && i + 1 < argc) {
+            opts->latency_map_file = argv[++i];
+        } else if (strcmp(argv[i], "--binlog") == 0 && i + 1 < argc) {
+            opts->binlog_file = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            opts->json_file = argv[++i];
+        } else if (strcmp(argv[i], "--events") == 0 && i + 1 < argc) {
+            opts->events_target = argv[++i];
+        } else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+            opts->top_ranges = atoi(argv[++i]);
+            if (opts->top_ranges < 1) {
+                fprintf(stderr, "错误: 区间数必须大于 0\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--heatmap") == 0 && i + 1 < argc) {
+            opts->heatmap_file = argv[++i];
+        } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            opts->profile_file = argv[++i];
+        } else if (strcmp(argv[i], "--profile-windows") == 0 && i + 1 < argc) {
+            opts->profile_windows = atoi(argv[++i]);
+            if (opts->profile_windows < 1 || opts->profile_windows > PROFILE_MAX_WINDOWS) {
+                fprintf(stderr, "错误: 吞吐曲线窗口数必须在 1 到 %d 之间\n", PROFILE_MAX_WINDOWS);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--ranges") == 0 && i + 1 < argc) {
+            opts->ranges_file = argv[++i];
+        } else if (strcmp(argv[i], "--badblocks") == 0 && i + 1 < argc) {
+            opts->badblocks_file = argv[++i];
+        } else if (strcmp(argv[i], "--fs-block-size") == 0 && i + 1 < argc) {
+            opts->fs_block_size = strtoul(argv[++i], NULL, 10);
+            if (opts->fs_block_size == 0 || opts->fs_block_size % 512 != 0) {
+                fprintf(stderr, "错误: 文件系统块大小必须是 512 的倍数\n");
+                return 1;
+            }
         } else if (strcmp(argv[i], "-L") == 0 && i + 1 < argc) {
-            opts->log_threshold = atoi(argv[++i]);
+            if (parse_latency(argv[++i], &opts->log_threshold) != 0) {
+                fprintf(stderr, "错误: 无效的日志阈值 '%s'\n", argv[i]);
+                return 1;
+            }
         } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
             opts->config_file = argv[++i];
         } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
             opts->sample_ratio = atof(argv[++i]);
         } else if (strcmp(argv[i], "-r") == 0) {
             opts->random_sampling = 1;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            char *endptr;
+            errno = 0;
+            opts->seed = strtoull(argv[++i], &endptr, 0);
+            if (errno != 0 || endptr == argv[i] || *endptr != '\0') {
+                fprintf(stderr, "错误: 无效的随机种子 '%s'\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--coverage") == 0 && i + 1 < argc) {
+            opts->coverage_file = argv[++i];
+        } else if (strcmp(argv[i], "--low-discrepancy") == 0) {
+            opts->low_discrepancy = 1;
+        } else if (strcmp(argv[i], "--refine") == 0) {
+            opts->refine = 1;
+        } else if (strcmp(argv[i], "--calibrate") == 0) {
+            opts->calibrate = 1;
+        } else if (strcmp(argv[i], "--bench-cell") == 0 && i + 1 < argc) {
+            if (parse_latency(argv[++i], &opts->bench_cell_us) != 0 || opts->bench_cell_us <= 0) {
+                fprintf(stderr, "错误: 无效的测量时长 '%s'\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--bench-ceiling") == 0 && i + 1 < argc) {
+            if (parse_latency(argv[++i], &opts->bench_ceiling) != 0 || opts->bench_ceiling <= 0) {
+                fprintf(stderr, "错误: 无效的延迟上限 '%s'\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--bench-db") == 0 && i + 1 < argc) {
+            opts->bench_db = argv[++i];
+        } else if (strcmp(argv[i], "--time-budget") == 0 && i + 1 < argc) {
+            if (parse_duration(argv[++i], &opts->time_budget) != 0) {
+                fprintf(stderr, "错误: 无效的时间预算 '%s'\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--ldc-window") == 0 && i + 1 < argc) {
+            opts->ldc_window = strtoul(argv[++i], NULL, 10);
         } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
             opts->wait_factor = atoi(argv[++i]);
         } else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) {
-            opts->suspect_threshold = atoi(argv[++i]);
+            if (parse_latency(argv[++i], &opts->suspect_threshold) != 0) {
+                fprintf(stderr, "错误: 无效的可疑块阈值 '%s'\n", argv[i]);
+                return 1;
+            }
         } else if (strcmp(argv[i], "-R") == 0 && i + 1 < argc) {
             opts->suspect_retries = atoi(argv[++i]);
         } else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc) {
             opts->suspect_interval = atoi(argv[++i]);
-        } else {
-            if (positional_args == 0) {
-                opts->device = argv[i];
+        } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            const char *engine = argv[++i];
+            if (strcmp(engine, "sync") == 0) {
+                opts->engine = ENGINE_SYNC;
+            } else if (strcmp(engine, "uring") == 0 || strcmp(engine, "io_uring") == 0) {
+                opts->engine = ENGINE_URING;
+            } else if (strcmp(engine, "threads") == 0) {
+                opts->engine = ENGINE_THREADS;
+            } else {
+                fprintf(stderr, "错误: 未知的读取引擎 '%s'（可选 sync, uring, threads）\n", engine);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+            opts->queue_depth = atoi(argv[++i]);
+            if (opts->queue_depth < 1 || opts->queue_depth > MAX_QUEUE_DEPTH) {
+                fprintf(stderr, "错误: 队列深度必须在 1-%d 之间\n", MAX_QUEUE_DEPTH);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--async-retest") == 0) {
+            opts->async_retest = 1;
+        } else if (strcmp(argv[i], "--adaptive-retest") == 0) {
+            opts->adaptive_retest = 1;
+        } else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            opts->checkpoint_file = argv[++i];
+        } else if (strcmp(argv[i], "--checkpoint-interval") == 0 && i + 1 < argc) {
+            opts->checkpoint_interval = atoi(argv[++i]);
+            if (opts->checkpoint_interval < 1) {
+                fprintf(stderr, "错误: 断点保存间隔必须至少 1 秒\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--resume") == 0) {
+            opts->resume = 1;
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            opts->fine_block_size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            opts->threads = atoi(argv[++i]);
+            if (opts->threads < 1 || opts->threads > MAX_THREADS) {
+                fprintf(stderr, "错误: 线程数必须在 1-%d 之间\n", MAX_THREADS);
+                return 1;
+            }
+        } else {
+            if (positional_args == 0) {
+                opts->device = argv[i];
             } else if (positional_args == 1) {
                 opts->start_str = argv[i];
             } else if (positional_args == 2) {
@@ -413,16 +1324,55 @@ int parse_arguments(int argc, char *argv[], ScanOptions *opts) {
         return 1;
     }
 
+    if (opts->resume && !opts->checkpoint_file) {
+        fprintf(stderr, "错误: --resume 需要用 --checkpoint 指定断点文件\n");
+        return 1;
+    }
+
     // 在这里打印命令行参数信息
+    char latency[32];
     printf("\033[36m【参数信息】\033[m设备: %s\n", opts->device);
     printf("\033[36m【参数信息】\033[m测试范围: %s - %s\n", opts->start_str, opts->end_str);
     printf("\033[36m【参数信息】\033[m块大小: %zu 字节\n", opts->block_size);
+    if (opts->fine_block_size > 0) {
+        printf("\033[36m【参数信息】\033[m分层扫描: 细分到 %zu 字节\n", opts->fine_block_size);
+    }
     if (opts->log_filename) {
         printf("\033[36m【参数信息】\033[m日志文件: %s\n", opts->log_filename);
-        printf("\033[36m【参数信息】\033[m日志阈值: %d ms\n", opts->log_threshold);
+        printf("\033[36m【参数信息】\033[m日志阈值: %s\n",
+               format_latency(opts->log_threshold, latency, sizeof(latency)));
     } else {
         printf("\033[36m【参数信息】\033[m日志文件: 无\n");
     }
+    if (opts->latency_map_file) {
+        printf("\033[36m【参数信息】\033[m延迟图文件: %s\n", opts->latency_map_file);
+    }
+    if (opts->binlog_file) {
+        printf("\033[36m【参数信息】\033[m二进制日志: %s\n", opts->binlog_file);
+    }
+    if (opts->json_file) {
+        printf("\033[36m【参数信息】\033[mJSON 报告: %s\n", opts->json_file);
+    }
+    if (opts->events_target) {
+        printf("\033[36m【参数信息】\033[m事件流: %s\n", opts->events_target);
+    }
+    if (opts->heatmap_file) {
+        printf("\033[36m【参数信息】\033[m热力图: %s\n", opts->heatmap_file);
+    }
+    if (opts->profile_file) {
+        printf("\033[36m【参数信息】\033[m吞吐曲线: %s (%d 个窗口)\n", opts->profile_file, opts->profile_windows);
+    }
+    if (opts->ranges_file) {
+        printf("\033[36m【参数信息】\033[m区间列表: %s\n", opts->ranges_file);
+    }
+    if (opts->badblocks_file) {
+        printf("\033[36m【参数信息】\033[m坏块列表: %s (文件系统块大小 %zu 字节)\n",
+               opts->badblocks_file, opts->fs_block_size);
+    }
+    if (opts->checkpoint_file) {
+        printf("\033[36m【参数信息】\033[m断点文件: %s (每 %d 秒保存%s)\n", opts->checkpoint_file,
+               opts->checkpoint_interval, opts->resume ? "，从断点继续" : "");
+    }
     if (opts->config_file) {
         printf("\033[36m【参数信息】\033[m配置文件: %s\n", opts->config_file);
     } else {
@@ -430,10 +1380,37 @@ int parse_arguments(int argc, char *argv[], ScanOptions *opts) {
     }
     printf("\033[36m【参数信息】\033[m抽样比例: %.2f%%\n", opts->sample_ratio);
     printf("\033[36m【参数信息】\033[m随机采样: %s\n", opts->random_sampling ? "启用" : "禁用");
+    if (opts->random_sampling) {
+        printf("\033[36m【参数信息】\033[m随机种子: %llu\n", (unsigned long long)opts->seed);
+    }
+    if (opts->coverage_file) {
+        printf("\033[36m【参数信息】\033[m覆盖位图: %s\n", opts->coverage_file);
+    }
+    if (opts->low_discrepancy) {
+        printf("\033[36m【参数信息】\033[m采样顺序: 低差异序列\n");
+    }
     printf("\033[36m【参数信息】\033[m等待时间因子: %d\n", opts->wait_factor);
-    printf("\033[36m【参数信息】\033[m可疑块阈值: %d ms\n", opts->suspect_threshold);
-    printf("\033[36m【参数信息】\033[m可疑块重测次数: %d\n", opts->suspect_retries);
+    printf("\033[36m【参数信息】\033[m可疑块阈值: %s\n",
+           format_latency(opts->suspect_threshold, latency, sizeof(latency)));
+    printf("\033[36m【参数信息】\033[m可疑块重测次数: %s%d\n",
+           opts->adaptive_retest ? "自适应，最多 " : "", opts->suspect_retries);
     printf("\033[36m【参数信息】\033[m可疑块重测间隔: %d ms\n", opts->suspect_interval);
+    printf("\033[36m【参数信息】\033[m可疑块重测方式: %s\n", opts->async_retest ? "后台异步" : "同步");
+    if (opts->engine == ENGINE_URING) {
+        if (opts->queue_depth > 0) {
+            printf("\033[36m【参数信息】\033[m读取引擎: io_uring (队列深度 %d)\n", opts->queue_depth);
+        } else {
+            printf("\033[36m【参数信息】\033[m读取引擎: io_uring (队列深度自动)\n");
+        }
+    } else if (opts->engine == ENGINE_THREADS) {
+        if (opts->threads > 0) {
+            printf("\033[36m【参数信息】\033[m读取引擎: 多线程 pread (%d 线程)\n", opts->threads);
+        } else {
+            printf("\033[36m【参数信息】\033[m读取引擎: 多线程 pread (线程数自动)\n");
+        }
+    } else {
+        printf("\033[36m【参数信息】\033[m读取引擎: 同步读取\n");
+    }
 
     return 0;
 }
@@ -441,9 +1418,11 @@ int parse_arguments(int argc, char *argv[], ScanOptions *opts) {
 typedef struct {
     char device_type[32];    // "SSD", "HDD", "NVMe", "Unknown"
     int is_rotational;       // 1=机械硬盘, 0=固态硬盘
-    int rpm;                 // 转速，0表示SSD或未知
+    int rpm;                 // 转速，0表示SSD或未知（--calibrate 时实测）
+    long full_seek_us;       // 实测满行程寻道时间，0表示未测
     char model[64];          // 设备型号
     char vendor[32];         // 厂商
+    int nr_requests;         // 块设备请求队列长度，0表示未知
 } DeviceTypeInfo;
 
 // 检测设备类型
@@ -458,8 +1437,10 @@ int detect_device_type(const char *device_path, DeviceTypeInfo *info) {
     strcpy(info->device_type, "Unknown");
     info->is_rotational = -1;
     info->rpm = 0;
+    info->full_seek_us = 0;
     strcpy(info->model, "Unknown");
     strcpy(info->vendor, "Unknown");
+    info->nr_requests = 0;
 
     // 从设备路径提取设备名 (例如: /dev/sda -> sda)
     const char *dev_name = strrchr(device_path, '/');
@@ -554,6 +1535,16 @@ int detect_device_type(const char *device_path, DeviceTypeInfo *info) {
         fclose(file);
     }
 
+    // 获取请求队列长度
+    snprintf(sys_path, sizeof(sys_path), "/sys/block/%s/queue/nr_requests", main_dev);
+    file = fopen(sys_path, "r");
+    if (file) {
+        if (fgets(buffer, sizeof(buffer), file)) {
+            info->nr_requests = atoi(buffer);
+        }
+        fclose(file);
+    }
+
     printf("\033[1;94m【设备类型】\033[m设备类型检测结果:\n");
     printf("\033[1;94m【设备类型】\033[m  类型: %s\n", info->device_type);
     printf("\033[1;94m【设备类型】\033[m  厂商: %s\n", info->vendor);
@@ -568,85 +1559,139 @@ int detect_device_type(const char *device_path, DeviceTypeInfo *info) {
     } else if (info->is_rotational == 0) {
         printf("\033[1;94m【设备类型】\033[m  固态硬盘: 是\n");
     }
+    if (info->nr_requests > 0) {
+        printf("\033[1;94m【设备类型】\033[m  请求队列长度: %d\n", info->nr_requests);
+    }
 
     return 0;
 }
 
-// 根据设备类型推荐可疑块阈值
-int get_recommended_suspect_threshold(const DeviceTypeInfo *dev_info) {
+// 校准过的机械硬盘按实测机械参数缩放自动阈值。满行程寻道加一整圈旋转是无错误读取的最坏机械耗时，
+// 各转速档分类表中"正常"的上限对应典型硬盘的这一耗时，返回两者之比（限制在 0.5~2 倍），未校准时返回 1
+double rotational_latency_scale(const DeviceTypeInfo *dev_info) {
+    if (dev_info->is_rotational != 1 || dev_info->rpm <= 0 || dev_info->full_seek_us <= 0) return 1;
+
+    long nominal;
+    if (dev_info->rpm >= 10000) {
+        nominal = 20 * US_PER_MS;
+    } else if (dev_info->rpm >= 7200) {
+        nominal = 25 * US_PER_MS;
+    } else {
+        nominal = 40 * US_PER_MS;
+    }
+    double scale = (dev_info->full_seek_us + 60.0 * US_PER_SEC / dev_info->rpm) / nominal;
+    if (scale < 0.5) scale = 0.5;
+    if (scale > 2) scale = 2;
+    return scale;
+}
+
+// 根据设备类型推荐可疑块阈值（微秒）
+long get_recommended_suspect_threshold(const DeviceTypeInfo *dev_info) {
     if (dev_info->is_rotational == 0) {
         // SSD/NVMe
-        return 20;
+        return 20 * US_PER_MS;
     } else if (dev_info->is_rotational == 1) {
         // 机械硬盘
+        double scale = rotational_latency_scale(dev_info);
         if (dev_info->rpm >= 10000) {
-            return 60;  // 高速硬盘
+            return (long)(60 * US_PER_MS * scale);  // 高速硬盘
         } else if (dev_info->rpm >= 7200 || dev_info->rpm == 0) {
-            return 100; // 7200 RPM
+            return (long)(100 * US_PER_MS * scale); // 7200 RPM
         } else {
-            return 150; // 5400 RPM或更慢
+            return (long)(150 * US_PER_MS * scale); // 5400 RPM或更慢
         }
     }
     return DEFAULT_SUSPECT_THRESHOLD; // 未知类型
 }
 
+// 根据设备类型和请求队列长度推荐多线程引擎的线程数
+int get_recommended_thread_count(const DeviceTypeInfo *dev_info) {
+    int threads;
+    if (dev_info->is_rotational == 1) {
+        threads = 1;    // 机械硬盘多线程分段读取只会导致磁头来回寻道
+    } else if (strcmp(dev_info->device_type, "NVMe") == 0) {
+        threads = 32;
+    } else if (dev_info->is_rotational == 0) {
+        threads = 8;    // SATA SSD 的 NCQ 深度通常为 32
+    } else {
+        threads = 4;    // 未知类型
+    }
+
+    if (dev_info->nr_requests > 0 && threads > dev_info->nr_requests) {
+        threads = dev_info->nr_requests;
+    }
+
+    // I/O 线程大部分时间在等待，但也不宜远超 CPU 数
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus > 0 && threads > cpus * 4) threads = cpus * 4;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    if (threads < 1) threads = 1;
+
+    return threads;
+}
+
 // 根据设备类型生成默认配置
 int generate_auto_config(const DeviceTypeInfo *dev_type_info, TimeCategory *cats) {
     int count = 0;
 
     if (dev_type_info->is_rotational == 0) {
         // SSD/NVMe 配置
-        strcpy(cats[0].name, "极佳"); cats[0].max_time = 1;    strcpy(cats[0].color, "\033[1;32m");
-        strcpy(cats[1].name, "优秀"); cats[1].max_time = 3;    strcpy(cats[1].color, "\033[32m");
-        strcpy(cats[2].name, "良好"); cats[2].max_time = 5;    strcpy(cats[2].color, "\033[36m");
-        strcpy(cats[3].name, "正常"); cats[3].max_time = 10;   strcpy(cats[3].color, "\033[33m");
-        strcpy(cats[4].name, "偏慢"); cats[4].max_time = 20;   strcpy(cats[4].color, "\033[35m");
-        strcpy(cats[5].name, "异常"); cats[5].max_time = 50;   strcpy(cats[5].color, "\033[31m");
-        strcpy(cats[6].name, "严重"); cats[6].max_time = 100;  strcpy(cats[6].color, "\033[1;31m");
+        strcpy(cats[0].name, "极佳"); cats[0].max_time = 250;                 strcpy(cats[0].color, "\033[1;32m");
+        strcpy(cats[1].name, "优秀"); cats[1].max_time = 500;                 strcpy(cats[1].color, "\033[32m");
+        strcpy(cats[2].name, "良好"); cats[2].max_time = 1 * US_PER_MS;       strcpy(cats[2].color, "\033[36m");
+        strcpy(cats[3].name, "正常"); cats[3].max_time = 3 * US_PER_MS;       strcpy(cats[3].color, "\033[33m");
+        strcpy(cats[4].name, "偏慢"); cats[4].max_time = 10 * US_PER_MS;      strcpy(cats[4].color, "\033[35m");
+        strcpy(cats[5].name, "异常"); cats[5].max_time = 50 * US_PER_MS;      strcpy(cats[5].color, "\033[31m");
+        strcpy(cats[6].name, "严重"); cats[6].max_time = 100 * US_PER_MS;     strcpy(cats[6].color, "\033[1;31m");
         count = 7;
     } else if (dev_type_info->is_rotational == 1) {
         // 机械硬盘配置
         if (dev_type_info->rpm >= 10000) {
             // 高速硬盘 (10K/15K RPM)
-            strcpy(cats[0].name, "优秀"); cats[0].max_time = 6;    strcpy(cats[0].color, "\033[1;32m");
-            strcpy(cats[1].name, "良好"); cats[1].max_time = 12;   strcpy(cats[1].color, "\033[32m");
-            strcpy(cats[2].name, "正常"); cats[2].max_time = 20;   strcpy(cats[2].color, "\033[36m");
-            strcpy(cats[3].name, "偏慢"); cats[3].max_time = 40;   strcpy(cats[3].color, "\033[33m");
-            strcpy(cats[4].name, "较慢"); cats[4].max_time = 80;   strcpy(cats[4].color, "\033[35m");
-            strcpy(cats[5].name, "很慢"); cats[5].max_time = 150;  strcpy(cats[5].color, "\033[31m");
-            strcpy(cats[6].name, "极慢"); cats[6].max_time = 300;  strcpy(cats[6].color, "\033[1;31m");
+            strcpy(cats[0].name, "优秀"); cats[0].max_time = 6 * US_PER_MS;       strcpy(cats[0].color, "\033[1;32m");
+            strcpy(cats[1].name, "良好"); cats[1].max_time = 12 * US_PER_MS;      strcpy(cats[1].color, "\033[32m");
+            strcpy(cats[2].name, "正常"); cats[2].max_time = 20 * US_PER_MS;      strcpy(cats[2].color, "\033[36m");
+            strcpy(cats[3].name, "偏慢"); cats[3].max_time = 40 * US_PER_MS;      strcpy(cats[3].color, "\033[33m");
+            strcpy(cats[4].name, "较慢"); cats[4].max_time = 80 * US_PER_MS;      strcpy(cats[4].color, "\033[35m");
+            strcpy(cats[5].name, "很慢"); cats[5].max_time = 150 * US_PER_MS;     strcpy(cats[5].color, "\033[31m");
+            strcpy(cats[6].name, "极慢"); cats[6].max_time = 300 * US_PER_MS;     strcpy(cats[6].color, "\033[1;31m");
         } else if (dev_type_info->rpm >= 7200 || dev_type_info->rpm == 0) {
             // 7200 RPM 或未知转速
-            strcpy(cats[0].name, "优秀"); cats[0].max_time = 8;    strcpy(cats[0].color, "\033[1;32m");
-            strcpy(cats[1].name, "良好"); cats[1].max_time = 15;   strcpy(cats[1].color, "\033[32m");
-            strcpy(cats[2].name, "正常"); cats[2].max_time = 25;   strcpy(cats[2].color, "\033[36m");
-            strcpy(cats[3].name, "偏慢"); cats[3].max_time = 50;   strcpy(cats[3].color, "\033[33m");
-            strcpy(cats[4].name, "较慢"); cats[4].max_time = 100;  strcpy(cats[4].color, "\033[35m");
-            strcpy(cats[5].name, "很慢"); cats[5].max_time = 200;  strcpy(cats[5].color, "\033[31m");
-            strcpy(cats[6].name, "极慢"); cats[6].max_time = 500;  strcpy(cats[6].color, "\033[1;31m");
+            strcpy(cats[0].name, "优秀"); cats[0].max_time = 8 * US_PER_MS;       strcpy(cats[0].color, "\033[1;32m");
+            strcpy(cats[1].name, "良好"); cats[1].max_time = 15 * US_PER_MS;      strcpy(cats[1].color, "\033[32m");
+            strcpy(cats[2].name, "正常"); cats[2].max_time = 25 * US_PER_MS;      strcpy(cats[2].color, "\033[36m");
+            strcpy(cats[3].name, "偏慢"); cats[3].max_time = 50 * US_PER_MS;      strcpy(cats[3].color, "\033[33m");
+            strcpy(cats[4].name, "较慢"); cats[4].max_time = 100 * US_PER_MS;     strcpy(cats[4].color, "\033[35m");
+            strcpy(cats[5].name, "很慢"); cats[5].max_time = 200 * US_PER_MS;     strcpy(cats[5].color, "\033[31m");
+            strcpy(cats[6].name, "极慢"); cats[6].max_time = 500 * US_PER_MS;     strcpy(cats[6].color, "\033[1;31m");
         } else {
             // 5400 RPM 或更慢
-            strcpy(cats[0].name, "优秀"); cats[0].max_time = 12;   strcpy(cats[0].color, "\033[1;32m");
-            strcpy(cats[1].name, "良好"); cats[1].max_time = 25;   strcpy(cats[1].color, "\033[32m");
-            strcpy(cats[2].name, "正常"); cats[2].max_time = 40;   strcpy(cats[2].color, "\033[36m");
-            strcpy(cats[3].name, "偏慢"); cats[3].max_time = 80;   strcpy(cats[3].color, "\033[33m");
-            strcpy(cats[4].name, "较慢"); cats[4].max_time = 150;  strcpy(cats[4].color, "\033[35m");
-            strcpy(cats[5].name, "很慢"); cats[5].max_time = 300;  strcpy(cats[5].color, "\033[31m");
-            strcpy(cats[6].name, "极慢"); cats[6].max_time = 600;  strcpy(cats[6].color, "\033[1;31m");
+            strcpy(cats[0].name, "优秀"); cats[0].max_time = 12 * US_PER_MS;      strcpy(cats[0].color, "\033[1;32m");
+            strcpy(cats[1].name, "良好"); cats[1].max_time = 25 * US_PER_MS;      strcpy(cats[1].color, "\033[32m");
+            strcpy(cats[2].name, "正常"); cats[2].max_time = 40 * US_PER_MS;      strcpy(cats[2].color, "\033[36m");
+            strcpy(cats[3].name, "偏慢"); cats[3].max_time = 80 * US_PER_MS;      strcpy(cats[3].color, "\033[33m");
+            strcpy(cats[4].name, "较慢"); cats[4].max_time = 150 * US_PER_MS;     strcpy(cats[4].color, "\033[35m");
+            strcpy(cats[5].name, "很慢"); cats[5].max_time = 300 * US_PER_MS;     strcpy(cats[5].color, "\033[31m");
+            strcpy(cats[6].name, "极慢"); cats[6].max_time = 600 * US_PER_MS;     strcpy(cats[6].color, "\033[1;31m");
         }
         count = 7;
+
+        double scale = rotational_latency_scale(dev_type_info);
+        for (int i = 0; i < count; i++) {
+            cats[i].max_time = (long)(cats[i].max_time * scale);
+        }
     } else {
         // 未知设备类型，使用保守配置
-        strcpy(cats[0].name, "优秀"); cats[0].max_time = 50;    strcpy(cats[0].color, "\033[1;32m");
-        strcpy(cats[1].name, "良好"); cats[1].max_time = 100;   strcpy(cats[1].color, "\033[32m");
-        strcpy(cats[2].name, "一般"); cats[2].max_time = 200;   strcpy(cats[2].color, "\033[36m");
-        strcpy(cats[3].name, "较差"); cats[3].max_time = 500;   strcpy(cats[3].color, "\033[33m");
-        strcpy(cats[4].name, "很差"); cats[4].max_time = 1000;  strcpy(cats[4].color, "\033[35m");
-        strcpy(cats[5].name, "严重"); cats[5].max_time = 3000;  strcpy(cats[5].color, "\033[31m");
+        strcpy(cats[0].name, "优秀"); cats[0].max_time = 50 * US_PER_MS;      strcpy(cats[0].color, "\033[1;32m");
+        strcpy(cats[1].name, "良好"); cats[1].max_time = 100 * US_PER_MS;     strcpy(cats[1].color, "\033[32m");
+        strcpy(cats[2].name, "一般"); cats[2].max_time = 200 * US_PER_MS;     strcpy(cats[2].color, "\033[36m");
+        strcpy(cats[3].name, "较差"); cats[3].max_time = 500 * US_PER_MS;     strcpy(cats[3].color, "\033[33m");
+        strcpy(cats[4].name, "很差"); cats[4].max_time = 1000 * US_PER_MS;    strcpy(cats[4].color, "\033[35m");
+        strcpy(cats[5].name, "严重"); cats[5].max_time = 3000 * US_PER_MS;    strcpy(cats[5].color, "\033[31m");
         count = 6;
     }
 
-    int recommended = get_recommended_suspect_threshold(dev_type_info);
+    long recommended = get_recommended_suspect_threshold(dev_type_info);
     strcpy(cats[count].name, "可疑"); cats[count].max_time = recommended;
     strcpy(cats[count].color, "\033[1;33m");
     count++;
@@ -675,7 +1720,7 @@ typedef struct {
 
 // 获取设备信息并解析范围参数
 int get_device_info(const char *device, const char *start_str, const char *end_str,
-                   size_t block_size, DeviceInfo *info) {
+                   size_t block_size, size_t fine_block_size, DeviceInfo *info) {
     // 获取设备信息
     int fd_info = open(device, O_RDONLY);
     if (fd_info == -1) {
@@ -729,6 +1774,17 @@ int get_device_info(const char *device, const char *start_str, const char *end_s
     // 计算每块包含的扇区数
     info->sectors_per_block = block_size / info->sector_size;
 
+    // 验证分层扫描的细分粒度
+    if (fine_block_size > 0) {
+        size_t ratio = block_size / fine_block_size;
+        if (fine_block_size % info->sector_size != 0 || fine_block_size >= block_size ||
+            block_size % fine_block_size != 0 || (ratio & (ratio - 1)) != 0) {
+            fprintf(stderr, "错误: 细分块大小(%zu)必须是扇区大小(%d)的倍数，且块大小(%zu)是它的 2 的幂倍\n",
+                    fine_block_size, info->sector_size, block_size);
+            return -1;
+        }
+    }
+
     // 调整起始位置使其按块对齐
     unsigned long aligned_start_sector = (info->start_sector / info->sectors_per_block) * info->sectors_per_block;
     if (aligned_start_sector < info->start_sector) {
@@ -762,6 +1818,284 @@ int get_device_info(const char *device, const char *start_str, const char *end_s
     return 0;
 }
 
+// 延迟图文件：文件头之后每块 1 字节，按块号索引。
+// 0 表示未扫描；最高位表示读取错误；低 7 位为对数量化的延迟，
+// 值 c 表示延迟不低于 2^o × (1 + q/4) 微秒，其中 o = (c-1)/4，q = (c-1)%4
+#define LATENCY_MAP_MAGIC       "GBLMAP01"
+#define LATENCY_MAP_ERROR       0x80
+#define LATENCY_MAP_CODE_MAX    0x7f
+
+typedef struct {
+    char        magic[8];
+    uint32_t    header_size;
+    uint32_t    sector_size;
+    uint64_t    block_size;
+    uint64_t    start_sector;
+    uint64_t    block_count;
+    uint64_t    sectors_per_block;
+    uint64_t    sector_offset;
+    int64_t     created;            // 创建时间（Unix 时间戳）
+    char        reserved[8];
+} LatencyMapHeader;
+
+// 延迟（微秒）量化为延迟图的字节值
+unsigned char latency_map_encode(long us) {
+    if (us < 1) us = 1;
+
+    int octave = 63 - __builtin_clzl((unsigned long)us);
+    int quarter = octave >= 2 ? (us >> (octave - 2)) & 3 : (us << (2 - octave)) & 3;
+    int code = 1 + octave * 4 + quarter;
+    return code > LATENCY_MAP_CODE_MAX ? LATENCY_MAP_CODE_MAX : code;
+}
+
+// 延迟图字节值对应的延迟下限（微秒）
+long latency_map_decode(unsigned char code) {
+    code &= LATENCY_MAP_CODE_MAX;
+    if (code == 0) return 0;
+
+    int octave = (code - 1) / 4;
+    int quarter = (code - 1) % 4;
+    return (1L << octave) + quarter * (1L << octave) / 4;
+}
+
+// 创建延迟图文件并映射到内存，返回块数据的起始地址；扫描过程中直接写内存，
+// 由内核回写文件，热路径上没有任何系统调用。keep 为 1 时（续扫）保留布局相同的已有内容
+unsigned char *latency_map_create(const char *path, const DeviceInfo *info, size_t block_size,
+                                  size_t *length, int keep) {
+    int map_fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (map_fd == -1) {
+        fprintf(stderr, "错误: 无法创建延迟图文件 '%s': %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    *length = sizeof(LatencyMapHeader) + info->block_count;
+    struct stat st;
+    if (keep && (fstat(map_fd, &st) != 0 || st.st_size != (off_t)*length)) {
+        keep = 0;
+    }
+    if (!keep && (ftruncate(map_fd, 0) != 0 || ftruncate(map_fd, *length) != 0)) {
+        fprintf(stderr, "错误: 无法设置延迟图文件大小: %s\n", strerror(errno));
+        close(map_fd);
+        return NULL;
+    }
+
+    void *base = mmap(NULL, *length, PROT_READ | PROT_WRITE, MAP_SHARED, map_fd, 0);
+    close(map_fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "错误: 无法映射延迟图文件: %s\n", strerror(errno));
+        return NULL;
+    }
+
+    LatencyMapHeader *header = base;
+    if (keep) {
+        if (memcmp(header->magic, LATENCY_MAP_MAGIC, sizeof(header->magic)) == 0 &&
+            header->block_size == block_size && header->start_sector == info->start_sector &&
+            header->block_count == info->block_count) {
+            return (unsigned char *)base + sizeof(LatencyMapHeader);
+        }
+        fprintf(stderr, "警告: 延迟图文件 '%s' 与本次扫描不符，重新创建\n", path);
+        memset(base, 0, *length);
+    }
+
+    memcpy(header->magic, LATENCY_MAP_MAGIC, sizeof(header->magic));
+    header->header_size       = sizeof(LatencyMapHeader);
+    header->sector_size       = info->sector_size;
+    header->block_size        = block_size;
+    header->start_sector      = info->start_sector;
+    header->block_count       = info->block_count;
+    header->sectors_per_block = info->sectors_per_block;
+    header->sector_offset     = info->sector_offset;
+    header->created           = time(NULL);
+
+    return (unsigned char *)base + sizeof(LatencyMapHeader);
+}
+
+// 解除延迟图映射
+void latency_map_close(unsigned char *blocks, size_t length) {
+    if (!blocks) return;
+
+    void *base = blocks - sizeof(LatencyMapHeader);
+    msync(base, length, MS_ASYNC);
+    munmap(base, length);
+}
+
+// 覆盖位图文件：文件头之后每块 1 位，位为 1 表示本轮已扫描过。
+// 所有块都覆盖后开始新的一轮，因此重复的抽样扫描会优先检查从未扫描或最久未扫描的块
+#define COVERAGE_MAGIC      "GBCOV001"
+
+typedef struct {
+    char        magic[8];
+    uint64_t    block_size;
+    uint64_t    start_sector;
+    uint64_t    block_count;
+    uint64_t    cycle;              // 当前是第几轮覆盖，从 1 开始
+    int64_t     updated;            // 最后一次扫描时间（Unix 时间戳）
+    char        reserved[16];
+} CoverageHeader;
+
+CoverageHeader *coverage_header(unsigned char *bits) {
+    return (CoverageHeader *)(bits - sizeof(CoverageHeader));
+}
+
+// 打开（或创建）覆盖位图并映射到内存，返回位图起始地址。
+// 布局与本次扫描不符时重新创建；上一轮已全部覆盖时开始新的一轮（续扫时除外）
+unsigned char *coverage_open(const char *path, const DeviceInfo *info, size_t block_size,
+                             size_t *length, int resume) {
+    int map_fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (map_fd == -1) {
+        fprintf(stderr, "错误: 无法打开覆盖位图文件 '%s': %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    *length = sizeof(CoverageHeader) + (info->block_count + 7) / 8;
+    struct stat st;
+    int existing = fstat(map_fd, &st) == 0 && st.st_size == (off_t)*length;
+    if (!existing && (ftruncate(map_fd, 0) != 0 || ftruncate(map_fd, *length) != 0)) {
+        fprintf(stderr, "错误: 无法设置覆盖位图文件大小: %s\n", strerror(errno));
+        close(map_fd);
+        return NULL;
+    }
+
+    void *base = mmap(NULL, *length, PROT_READ | PROT_WRITE, MAP_SHARED, map_fd, 0);
+    close(map_fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "错误: 无法映射覆盖位图文件: %s\n", strerror(errno));
+        return NULL;
+    }
+
+    CoverageHeader *header = base;
+    unsigned char *bits = (unsigned char *)base + sizeof(CoverageHeader);
+    if (existing && (memcmp(header->magic, COVERAGE_MAGIC, sizeof(header->magic)) != 0 ||
+                     header->block_size != block_size || header->start_sector != info->start_sector ||
+                     header->block_count != info->block_count)) {
+        fprintf(stderr, "警告: 覆盖位图 '%s' 与本次扫描的范围或块大小不符，重新开始\n", path);
+        memset(base, 0, *length);
+        existing = 0;
+    }
+    if (!existing) {
+        memcpy(header->magic, COVERAGE_MAGIC, sizeof(header->magic));
+        header->block_size   = block_size;
+        header->start_sector = info->start_sector;
+        header->block_count  = info->block_count;
+        header->cycle        = 1;
+    }
+
+    unsigned long covered = coverage_count(bits, 0, info->block_count);
+    if (covered == info->block_count && !resume) {
+        // 上一轮已全部覆盖，开始新的一轮
+        memset(bits, 0, *length - sizeof(CoverageHeader));
+        header->cycle++;
+        covered = 0;
+    }
+    header->updated = time(NULL);
+
+    printf("\033[33m【覆盖位图】\033[m第 %lu 轮，已覆盖 %lu / %lu 块 (%.2f%%)\n",
+           (unsigned long)header->cycle, covered, info->block_count,
+           100.0 * covered / info->block_count);
+    return bits;
+}
+
+// 输出覆盖情况并解除映射
+void coverage_close(unsigned char *bits, size_t length, unsigned long block_count, FILE *logfile) {
+    if (!bits) return;
+
+    CoverageHeader *header = coverage_header(bits);
+    unsigned long covered = coverage_count(bits, 0, block_count);
+    double percent = 100.0 * covered / block_count;
+
+    printf("覆盖位图: 第 %lu 轮，已覆盖 %lu / %lu 块 (%.2f%%)\n",
+           (unsigned long)header->cycle, covered, block_count, percent);
+    if (logfile) {
+        fprintf(logfile, "# 覆盖位图: 第 %lu 轮，已覆盖 %lu / %lu 块 (%.2f%%)\n",
+                (unsigned long)header->cycle, covered, block_count, percent);
+    }
+
+    msync(header, length, MS_ASYNC);
+    munmap(header, length);
+}
+
+// 查看延迟图：输出文件信息、延迟分布，并列出读取错误及不低于阈值的块
+int dump_latency_map(const char *path, long threshold) {
+    int map_fd = open(path, O_RDONLY);
+    if (map_fd == -1) {
+        fprintf(stderr, "错误: 无法打开延迟图文件 '%s': %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    struct stat st;
+    if (fstat(map_fd, &st) != 0 || st.st_size < (off_t)sizeof(LatencyMapHeader)) {
+        fprintf(stderr, "错误: '%s' 不是有效的延迟图文件\n", path);
+        close(map_fd);
+        return 1;
+    }
+
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, map_fd, 0);
+    close(map_fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "错误: 无法映射延迟图文件: %s\n", strerror(errno));
+        return 1;
+    }
+
+    const LatencyMapHeader *header = base;
+    if (memcmp(header->magic, LATENCY_MAP_MAGIC, sizeof(header->magic)) != 0 ||
+        header->header_size != sizeof(LatencyMapHeader) ||
+        (uint64_t)st.st_size < header->header_size + header->block_count) {
+        fprintf(stderr, "错误: '%s' 不是有效的延迟图文件\n", path);
+        munmap(base, st.st_size);
+        return 1;
+    }
+
+    const unsigned char *blocks = (const unsigned char *)base + header->header_size;
+    char latency[32];
+    unsigned long code_counts[LATENCY_MAP_CODE_MAX + 1] = {0};
+    unsigned long scanned = 0, errors = 0;
+
+    printf("延迟图: %s\n", path);
+    printf("创建时间: %ld\n", (long)header->created);
+    printf("起始扇区: %lu  扇区大小: %u 字节  块大小: %lu 字节  块数: %lu\n",
+           (unsigned long)header->start_sector, header->sector_size,
+           (unsigned long)header->block_size, (unsigned long)header->block_count);
+    printf("------------------------\n");
+
+    for (uint64_t i = 0; i < header->block_count; i++) {
+        unsigned char value = blocks[i];
+        if (value == 0) continue;
+
+        scanned++;
+        if (value & LATENCY_MAP_ERROR) {
+            errors++;
+        } else {
+            code_counts[value]++;
+        }
+
+        if ((value & LATENCY_MAP_ERROR) || latency_map_decode(value) >= threshold) {
+            unsigned long sector = i * header->sectors_per_block + header->sector_offset;
+            if (value & LATENCY_MAP_ERROR) {
+                printf("%lu # 读取错误\n", sector);
+            } else {
+                printf("%lu # ≥ %s\n", sector,
+                       format_latency(latency_map_decode(value), latency, sizeof(latency)));
+            }
+        }
+    }
+
+    printf("------------------------\n");
+    printf("已扫描块数: %lu (%.2f%%)  读取错误: %lu\n", scanned,
+           header->block_count > 0 ? 100.0 * scanned / header->block_count : 0.0, errors);
+    for (int octave = 0; octave * 4 + 1 <= LATENCY_MAP_CODE_MAX; octave++) {
+        unsigned long count = 0;
+        for (int q = 0; q < 4 && octave * 4 + 1 + q <= LATENCY_MAP_CODE_MAX; q++) {
+            count += code_counts[octave * 4 + 1 + q];
+        }
+        if (count == 0) continue;
+        printf("  ≥ %8s: %10lu 块\n",
+               format_latency(1L << octave, latency, sizeof(latency)), count);
+    }
+
+    munmap(base, st.st_size);
+    return 0;
+}
+
 // 初始化扫描环境
 int initialize_scan(const char *device, size_t block_size, const DeviceInfo *info,
                    int *fd, void **buffer, FILE **logfile, const char *log_filename) {
@@ -807,244 +2141,3949 @@ int initialize_scan(const char *device, size_t block_size, const DeviceInfo *inf
     return 0;
 }
 
-// 执行主要的扫描过程
-void perform_scan(int fd, void *buffer, const ScanOptions *opts, const DeviceInfo *info,
-                 TimeCategory *categories, int cat_count, FILE *logfile) {
-
-    // 初始化采样迭代器
-    SampleIterator iterator;
-    init_sample_iterator(&iterator, info->block_count, opts->sample_ratio, opts->random_sampling);
-
-    printf("\033[1;37m【采样策略】\033[m计划扫描块数: %lu (共 %lu 块)\n", iterator.total_samples, info->block_count);
-    // 判断是否为顺序扫描 (100% 均匀采样)
-    int is_sequential = (opts->sample_ratio >= 100.0 && !opts->random_sampling);
-    printf("\033[1;37m【采样策略】\033[m扫描策略: \033[32m%s\033[m\n", is_sequential ? "顺序全量扫描" : "跳跃式前进扫描");
-    if (!is_sequential) {
-        printf("\033[1;37m【采样策略】\033[m抽样比例: %.1f%%\n", opts->sample_ratio);
-        printf("\033[1;37m【采样策略】\033[m采样模式: \033[32m%s\033[m\n", opts->random_sampling ? "随机采样" : "均匀采样");
-    }
-    if (opts->wait_factor > 0) {
-        printf("\033[1;37m【采样策略】\033[m等待时间因子: %d%%\n", opts->wait_factor);
+// 查找延迟对应的分类序号（不含可疑分类），超出所有分类时返回坏道分类
+int find_category(const TimeCategory *categories, int cat_count, long elapsed) {
+    for (int j = 0; j < cat_count - 2; j++) { // 排除可疑和坏道分类
+        if (elapsed <= categories[j].max_time) {
+            return j;
+        }
     }
-    printf("\033[1;37m【采样策略】\033[m可疑块阈值: %d ms (重测 %d 次，间隔 %d ms)\n",
-           opts->suspect_threshold, opts->suspect_retries, opts->suspect_interval);
-
-    // 计算报告间隔
-    unsigned long report_interval = iterator.total_samples / 100;
-    if (report_interval < MIN_REPORT_INTERVAL) report_interval = MIN_REPORT_INTERVAL;
-    if (report_interval > 100000) report_interval = 100000;
+    return cat_count - 1;
+}
 
-    struct timespec global_start;
-    clock_gettime(CLOCK_MONOTONIC, &global_start);
+// 可疑块重测任务
+typedef struct {
+    off_t   offset;         // 字节偏移
+    size_t  size;           // 读取长度（字节）
+    long   *samples;        // 各次重测的延迟（微秒）
+    int     sample_count;
+    int     failed;         // 重测中出现读取失败
+    int     decided;        // 样本已足以判定快慢，提前停止
+} RetestJob;
+
+// 冲刷读取可用的设备容量（字节）。BLKGETSIZE 的单位固定为 512 字节，
+// 取不到时（如映像文件）退回到扫描范围的末尾
+off_t retest_device_size(const DeviceInfo *info) {
+    if (info->total_sectors > 0) {
+        return (off_t)info->total_sectors * 512;
+    }
+    return (off_t)(info->end_sector + 1) * info->sector_size;
+}
 
-    printf("========================================\n");
+// 第 k 次冲刷读取的位置：距 offset 四分之一到四分之三个设备容量，按黄金分割步进，
+// 每次读取的位置都不同，避免冲刷读取本身命中硬盘缓存
+off_t retest_flush_offset(const DeviceInfo *info, off_t offset, unsigned long k) {
+    off_t device_size = retest_device_size(info);
+    if (device_size < 4 * info->sector_size) return 0;
 
-    print_progress_report(0, iterator.total_samples, categories, cat_count, &global_start);
+    off_t spread = device_size / 2;
+    double frac = fmod(k * 0.6180339887498949, 1.0);
+    off_t pos = (offset + device_size / 4 + (off_t)(frac * spread)) % device_size;
+    return pos - pos % info->sector_size;
+}
 
-    struct timespec block_start, block_end;
-    const char *default_status = "未知";
-    long last_elapsed = 0;  // 用于计算等待时间
-    unsigned long processed = 0;
-    long prev_block = -1;
+// 双侧 95% 置信区间的 t 分布临界值，下标为自由度
+static const double retest_t_table[] = {
+    0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+// 序贯判定：重测样本均值的 95% 置信区间完全落在 boundary 一侧时，
+// 已能确认该块正常或确实偏慢，无需读满 -R 次
+int retest_job_decided(const RetestJob *job, long boundary) {
+    int n = job->sample_count;
+    if (n < 2) return 0;
+
+    double sum = 0, sum_sq = 0;
+    for (int i = 0; i < n; i++) {
+        sum += job->samples[i];
+        sum_sq += (double)job->samples[i] * job->samples[i];
+    }
+    double mean = sum / n;
+    double variance = (sum_sq - sum * mean) / (n - 1);
+    if (variance < 0) variance = 0;
 
-    long current_block;
-    while ((current_block = get_next_sample_block(&iterator)) != -1) {
-        unsigned long block = (unsigned long)current_block;
-        long elapsed = 0;
-        const char *status = default_status;
-        int status_index = cat_count - 1; // 默认为最后一个分类（坏道）
-        int is_suspect = 0;
+    int df = n - 1;
+    double t = df < (int)(sizeof(retest_t_table) / sizeof(retest_t_table[0]))
+               ? retest_t_table[df] : 1.960;
+    double half_width = t * sqrt(variance / n);
 
-        processed++;
+    return mean + half_width < boundary || mean - half_width > boundary;
+}
 
-        // 等待时间处理
-        if (opts->wait_factor > 0 && last_elapsed > 0) {
-            long wait_time_ms = (last_elapsed * opts->wait_factor) / 100;
-            if (wait_time_ms > 0) {
-                struct timespec wait_time = {
-                    .tv_sec = wait_time_ms / 1000,
-                    .tv_nsec = (wait_time_ms % 1000) * 1000000
+// 交错重测一组可疑块。连续重读同一位置测到的大多是硬盘内部缓存而非介质，
+// 因此每轮依次读取各个可疑块，并在上一次读取离得不够远时先读一个远处的扇区，
+// 使每次重测都是一次真正的寻道和介质访问，无需空等。boundary > 0 时启用序贯判定，
+// 各块在样本足以判定快慢后即不再重测，retries 为上限
+void run_retest_jobs(int fd, void *buffer, const DeviceInfo *info,
+                     RetestJob *jobs, int count, int retries, int interval_ms,
+                     long boundary) {
+    off_t device_size = retest_device_size(info);
+    off_t min_distance = device_size / 4;
+    if (min_distance > RETEST_FAR_DISTANCE) min_distance = RETEST_FAR_DISTANCE;
+
+    off_t last_offset = -1;
+    unsigned long flushes = 0;
+
+    int active = count;
+    for (int round = 0; round < retries && active > 0; round++) {
+        for (int j = 0; j < count; j++) {
+            RetestJob *job = &jobs[j];
+            if (job->failed || job->decided) continue;
+
+            // 用户仍可指定额外停顿
+            if (interval_ms > 0) {
+                struct timespec sleep_time = {
+                    .tv_sec = interval_ms / 1000,
+                    .tv_nsec = (interval_ms % 1000) * 1000000
                 };
-                nanosleep(&wait_time, NULL);
+                nanosleep(&sleep_time, NULL);
             }
-        }
 
-        // 优化：顺序扫描且连续块时不需要lseek
-        if (!is_sequential || prev_block == -1 || block != (unsigned long)(prev_block + 1)) {
-            // 需要定位
-            off_t block_offset = (off_t)(block * info->sectors_per_block + info->sector_offset) * info->sector_size;
-            if (lseek(fd, block_offset, SEEK_SET) != block_offset) {
-                status = "定位错误";
-                elapsed = 1000000;
-                goto record_result;
+            off_t distance = last_offset > job->offset ? last_offset - job->offset
+                                                       : job->offset - last_offset;
+            if (last_offset < 0 || distance < min_distance) {
+                off_t flush = retest_flush_offset(info, job->offset, flushes++);
+                // 冲刷读取的结果和耗时都不关心，失败也不影响重测
+                ssize_t ignored = pread(fd, buffer, info->sector_size, flush);
+                (void)ignored;
             }
-        }
-
-        prev_block = (long)block;
-
-        clock_gettime(CLOCK_MONOTONIC, &block_start);
-        ssize_t bytes_read = read(fd, buffer, opts->block_size);
-        clock_gettime(CLOCK_MONOTONIC, &block_end);
 
-        if (bytes_read != (ssize_t)opts->block_size) {
-            status = "读取错误";
-            elapsed = 1000000;
-        } else {
-            elapsed = (block_end.tv_sec - block_start.tv_sec) * 1000 +
-                      (block_end.tv_nsec - block_start.tv_nsec) / 1000000;
-
-            // 检查是否为可疑块
-            if (elapsed > opts->suspect_threshold) {
-                is_suspect = 1;
-                categories[cat_count - 2].count++; // 可疑分类计数
-
-                // 进行重测
-                long retest_result = retest_suspect_block(fd, buffer, opts->block_size,
-                                                        block, info->sectors_per_block,
-                                                        info->sector_offset, info->sector_size,
-                                                        opts->suspect_retries,
-                                                        opts->suspect_interval);
-
-                if (retest_result < 0) {
-                    status = "读取错误";
-                    elapsed = 1000000;
-                }
-                else {
-                    elapsed = retest_result;
-                }
-            }
+            struct timespec start, end;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            ssize_t bytes_read = pread(fd, buffer, job->size, job->offset);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            last_offset = job->offset;
 
-            // 查找匹配的分类（排除可疑分类）
-            for (int j = 0; j < cat_count - 2; j++) { // 排除可疑和坏道分类
-                if (elapsed <= categories[j].max_time) {
-                    if (!is_suspect) categories[j].count++; // 只有非可疑块才增加计数
-                    status = categories[j].name;
-                    status_index = j;
-                    break;
-                }
+            if (bytes_read != (ssize_t)job->size) {
+                job->failed = 1; // 读取失败
+                active--;
+                continue;
             }
+            job->samples[job->sample_count++] = timespec_diff_us(&start, &end);
 
-            // 如果没有匹配到任何分类，归为坏道
-            if (status_index == cat_count - 1 && !is_suspect) {
-                categories[cat_count - 1].count++; // 坏道分类
-                status = categories[cat_count - 1].name;
+            if (boundary > 0 && retest_job_decided(job, boundary)) {
+                job->decided = 1;
+                active--;
             }
         }
+    }
+}
 
-record_result:
-        last_elapsed = elapsed;
+// 重测结果：平均延迟（微秒），样本多于 2 个时去掉最大最小值，读取失败时返回 -1
+long retest_job_result(const RetestJob *job) {
+    if (job->failed || job->sample_count == 0) {
+        return -1;
+    }
 
-        // 记录速度不好的区块
-        if (logfile && elapsed > opts->log_threshold) {
-            log_block(logfile, block, info->sector_offset, opts->block_size,
-                      info->sectors_per_block, elapsed, status);
-        }
+    // 找出最大值和最小值，无需排序
+    long min_val = job->samples[0];
+    long max_val = job->samples[0];
+    long sum = job->samples[0];
+    int valid_count = job->sample_count;
 
-        // 定期显示进度
-        if (processed == 1 || processed == iterator.total_samples || processed % report_interval == 0) {
-            print_progress_report(processed, iterator.total_samples, categories, cat_count, &global_start);
-        }
+    for (int i = 1; i < valid_count; i++) {
+        if (job->samples[i] < min_val) min_val = job->samples[i];
+        if (job->samples[i] > max_val) max_val = job->samples[i];
+        sum += job->samples[i];
     }
 
-    print_progress_report(iterator.total_samples, iterator.total_samples, categories, cat_count, &global_start);
-    printf("\n\n");
-}
+    if (valid_count > 2) {
+        sum = sum - min_val - max_val;
+        valid_count -= 2;
+    }
 
-// 生成最终报告
-void generate_final_report(const ScanOptions *opts, const DeviceInfo *info,
-                          TimeCategory *categories, int cat_count,
-                          struct timespec *start_time, FILE *logfile) {
-    // 计算总时间
-    struct timespec global_end;
-    clock_gettime(CLOCK_MONOTONIC, &global_end);
-    double total_sec = (global_end.tv_sec - start_time->tv_sec) +
-                      (global_end.tv_nsec - start_time->tv_nsec) / 1000000000.0;
+    return sum / valid_count;
+}
 
-    // 计算实际测试的块数（不包括可疑分类）
-    unsigned long actual_tested_blocks = 0;
-    unsigned long sample_count = (unsigned long)(info->block_count * opts->sample_ratio / 100.0);
-    if (sample_count == 0) sample_count = 1;
-    if (sample_count > info->block_count) sample_count = info->block_count;
+// 按扫描参数初始化采样迭代器。覆盖位图优先于低差异序列顺序。
+// stream 为多线程引擎中的线程序号，各线程使用同一种子下互不重叠的随机序列
+void init_scan_iterator(SampleIterator *iter, const ScanOptions *opts, unsigned long total_blocks,
+                        const unsigned char *coverage, unsigned long coverage_base, int stream) {
+    if (coverage) {
+        init_coverage_iterator(iter, total_blocks, opts->sample_ratio, opts->random_sampling,
+                               coverage, coverage_base);
+        rng_seed(iter->rng, opts->seed, stream);
+        iter->refine = opts->refine;
+        return;
+    }
 
-    for (int i = 0; i < cat_count; i++) {
-        if (i != cat_count - 2) { // 排除可疑分类
-            actual_tested_blocks += categories[i].count;
-        }
+    init_sample_iterator(iter, total_blocks, opts->sample_ratio, opts->random_sampling);
+    rng_seed(iter->rng, opts->seed, stream);
+    if (opts->low_discrepancy) {
+        sample_iterator_use_ldc(iter, opts->ldc_window);
     }
+    iter->refine = opts->refine && iter->total_samples < total_blocks;
+}
 
-    // 打印最终报告
-    printf("\n===== 坏道检测报告 =====\n");
-    printf("总扇区数: %lu (%.2f GB)\n", info->sector_count,
-           (double)info->sector_count * info->sector_size / (1024*1024*1024));
-    printf("总块数: %lu\n", info->block_count);
-    printf("抽样扫描块数: %lu (%.2f%%)\n", sample_count,
-           100.0 * sample_count / info->block_count);
-    printf("实际测试块数: %lu\n", actual_tested_blocks);
-    printf("总扫描时间: %.1f 秒\n", total_sec);
+// 异步日志：扫描线程只把定长记录放入无锁环形队列，由后台线程成批格式化写入文本日志（-l）
+// 和/或二进制日志（--binlog），读取路径上不再有 localtime/fprintf/fflush。
+// 队列满时生产者让出 CPU 等待，不丢弃记录。同一个写线程还负责 --events 的慢块/错误事件，
+// 并把慢块和错误合并成连续的扇区区间，供最终报告和导出使用
+#define BINLOG_MAGIC            "GBLOG001"
+#define RANGE_PENDING           4096    // 区间索引每攒够这么多条记录合并一次
+#define RANGE_INDEX_MAX         1000000 // 区间索引最多保存的区间数
+#define LOG_RING_SIZE           65536   // 2 的幂
+#define LOG_FLUSH_INTERVAL_US   50000   // 队列为空时写线程的休眠间隔
+#define LOG_STATUS_READ_ERROR   0xff    // 记录的状态：分类序号，或以下两种错误
+#define LOG_STATUS_SEEK_ERROR   0xfe
 
-    if (total_sec > 0) {
-        double mb_speed = (sample_count * opts->block_size) / (total_sec * 1024 * 1024);
-        printf("平均速度: %.1f MB/s\n", mb_speed);
+typedef struct {
+    uint64_t    sector;             // 起始扇区
+    int64_t     timestamp_ns;       // 记录时间（CLOCK_REALTIME）
+    uint32_t    latency_us;
+    uint32_t    sectors;
+    uint8_t     status;
+    uint8_t     reserved;
+    int16_t     error;              // 读取失败时的 errno，0 表示未知或读取不完整
+    uint32_t    reserved2;
+} LogRecord;
+
+typedef struct {
+    char        magic[8];
+    uint32_t    header_size;
+    uint32_t    record_size;
+    uint64_t    start_sector;
+    uint64_t    end_sector;
+    uint64_t    block_size;
+    uint32_t    sector_size;
+    int32_t     cat_count;
+    int64_t     created;            // 创建时间（Unix 时间戳）
+    char        device[64];
+    char        category_names[MAX_CATEGORIES][20];
+} BinaryLogHeader;
+
+// 慢块/坏块区间：扇区范围 [start, end)，相邻或重叠的记录合并为一个区间
+typedef struct {
+    uint64_t    start;
+    uint64_t    end;
+    uint32_t    records;            // 合并的记录数
+    uint32_t    errors;             // 其中读取失败的记录数
+    uint32_t    worst_latency_us;
+    uint32_t    worst_status;       // 最严重的状态：读取错误 > 定位错误 > 序号大的分类
+} BadRange;
+
+// 区间索引：按起始扇区排序、互不相邻的区间数组。新记录先放入待合并缓冲区，
+// 攒满后排序并与已有区间做一次线性归并，随机顺序到达的记录也只需均摊 O(log n)
+typedef struct {
+    BadRange           *ranges;
+    size_t              count;
+    BadRange           *pending;
+    size_t              pending_count;
+    unsigned long       dropped;        // 区间数达到 RANGE_INDEX_MAX 后未能保存的记录数
+} RangeIndex;
+
+int bad_range_compare_start(const void *a, const void *b) {
+    const BadRange *x = a, *y = b;
+    return x->start < y->start ? -1 : x->start > y->start;
+}
+
+// 把 range 并入有序输出的末尾，与最后一个区间相邻或重叠时合并
+void bad_range_append(BadRange *out, size_t *count, const BadRange *range) {
+    if (*count > 0 && range->start <= out[*count - 1].end) {
+        BadRange *last = &out[*count - 1];
+        if (range->end > last->end) last->end = range->end;
+        last->records += range->records;
+        last->errors += range->errors;
+        if (range->worst_latency_us > last->worst_latency_us) last->worst_latency_us = range->worst_latency_us;
+        if (range->worst_status > last->worst_status) last->worst_status = range->worst_status;
+    } else {
+        out[(*count)++] = *range;
     }
+}
 
-    printf("------------------------\n");
+// 把待合并缓冲区归并到区间数组
+void range_index_flush(RangeIndex *index) {
+    if (index->pending_count == 0) return;
+    qsort(index->pending, index->pending_count, sizeof(BadRange), bad_range_compare_start);
 
-    for (int i = 0; i < cat_count; i++) {
-        if (i == cat_count - 2) {
-            // 可疑分类单独处理
-            printf("%s%-6s\033[0m (>%4d ms): %8lu 块 (重测后重新分类)\n",
-                   categories[i].color, categories[i].name, opts->suspect_threshold,
-                   categories[i].count);
-        } else if (i < cat_count - 2) {
-            printf("%s%-6s\033[0m (≤%4ld ms): %8lu 块 (%5.2f%%)\n",
-                   categories[i].color, categories[i].name, categories[i].max_time,
-                   categories[i].count,
-                   actual_tested_blocks > 0 ? 100.0 * categories[i].count / actual_tested_blocks : 0.0);
+    BadRange *merged = malloc((index->count + index->pending_count) * sizeof(BadRange));
+    if (!merged) {
+        index->dropped += index->pending_count;
+        index->pending_count = 0;
+        return;
+    }
+    size_t count = 0, i = 0, j = 0;
+    while (i < index->count || j < index->pending_count) {
+        if (j == index->pending_count ||
+            (i < index->count && index->ranges[i].start <= index->pending[j].start)) {
+            bad_range_append(merged, &count, &index->ranges[i++]);
         } else {
-            // 坏道分类
-            printf("%s%-6s\033[0m (>%4ld ms): %8lu 块 (%5.2f%%)\n",
-                   categories[i].color, categories[i].name,
-                   cat_count > 2 ? categories[cat_count-3].max_time : 3000,
-                   categories[i].count,
-                   actual_tested_blocks > 0 ? 100.0 * categories[i].count / actual_tested_blocks : 0.0);
+            bad_range_append(merged, &count, &index->pending[j++]);
         }
     }
+    free(index->ranges);
+    index->ranges = merged;
+    index->count = count;
+    index->pending_count = 0;
+}
+
+void range_index_add(RangeIndex *index, const LogRecord *record) {
+    if (index->count >= RANGE_INDEX_MAX) {
+        index->dropped++;
+        return;
+    }
+    if (!index->pending) {
+        index->pending = malloc(RANGE_PENDING * sizeof(BadRange));
+        if (!index->pending) {
+            index->dropped++;
+            return;
+        }
+    }
+    int failed = record->status >= LOG_STATUS_SEEK_ERROR;
+    index->pending[index->pending_count++] = (BadRange) {
+        .start              = record->sector,
+        .end                = record->sector + record->sectors,
+        .records            = 1,
+        .errors             = failed,
+        .worst_latency_us   = record->latency_us,
+        .worst_status       = record->status,
+    };
+    if (index->pending_count == RANGE_PENDING) range_index_flush(index);
+}
+
+void range_index_free(RangeIndex *index) {
+    free(index->ranges);
+    free(index->pending);
+    memset(index, 0, sizeof(*index));
+}
+
+typedef struct {
+    LogRecord           record;
+    uint64_t            sequence;       // 等于写入位置时可写，等于写入位置 + 1 时记录可读
+} LogSlot;
+
+typedef struct {
+    LogSlot            *ring;
+    uint64_t            tail;           // 生产者竞争推进
+    uint64_t            head;           // 只由写线程推进
+    int                 stop;
+    FILE               *text;           // -l 文本日志，NULL 表示不写
+    FILE               *binary;         // --binlog 二进制日志，NULL 表示不写
+    FILE               *events;         // --events 事件流，NULL 表示不写
+    const TimeCategory *categories;
+    int                 cat_count;
+    pthread_t           thread;
+    // 只由写线程更新，写线程结束后供报告读取
+    RangeIndex          slow_ranges;    // 所有慢块和错误合并成的区间
+    RangeIndex          bad_ranges;     // 只含读取错误和坏道分类，用于导出坏块列表
+} ScanLogger;
+
+// 状态码对应的文本（分类名或错误类型）
+const char *log_status_name(const TimeCategory *categories, int cat_count, int status) {
+    if (status == LOG_STATUS_READ_ERROR) return "读取错误";
+    if (status == LOG_STATUS_SEEK_ERROR) return "定位错误";
+    return status < cat_count ? categories[status].name : "未知";
+}
+
+int log_status_code(const char *error_status) {
+    return strcmp(error_status, "定位错误") == 0 ? LOG_STATUS_SEEK_ERROR : LOG_STATUS_READ_ERROR;
+}
+
+// 按原有文本格式输出一条记录，读取失败时在状态后附上错误原因。
+// cached_sec/timestamp 缓存上一条记录的时间字符串
+void log_format_record(FILE *out, const LogRecord *record, const TimeCategory *categories,
+                       int cat_count, time_t *cached_sec, char timestamp[20]) {
+    const char *status = log_status_name(categories, cat_count, record->status);
+    char with_error[64];
+    if (record->error > 0) {
+        snprintf(with_error, sizeof(with_error), "%s (%s)", status, strerror(record->error));
+        status = with_error;
+    }
+
+    time_t sec = (time_t)(record->timestamp_ns / 1000000000LL);
+    if (sec != *cached_sec) {
+        struct tm t;
+        localtime_r(&sec, &t);
+        strftime(timestamp, 20, "%Y-%m-%d %H:%M:%S", &t);
+        *cached_sec = sec;
+    }
+
+    // 只记录第一个扇区，添加块大小信息
+    fprintf(out, "%lu # %s # %u.%03u ms # %s # %u sectors\n",
+            (unsigned long)record->sector, timestamp, record->latency_us / 1000,
+            record->latency_us % 1000, status, record->sectors);
+}
+
+// 以 NDJSON 格式输出一条慢块/错误事件
+void log_write_event(FILE *out, const LogRecord *record, const TimeCategory *categories, int cat_count) {
+    flockfile(out);     // 进度事件由另一个线程写入，保证每行完整
+    fprintf(out, "{\"event\":\"block\",\"time\":%.3f,\"sector\":%lu,\"sectors\":%u,\"latency_us\":%u,\"status\":",
+            record->timestamp_ns / 1e9, (unsigned long)record->sector, record->sectors, record->latency_us);
+    json_write_string(out, log_status_name(categories, cat_count, record->status));
+    fprintf(out, ",\"status_code\":%u", record->status);
+    if (record->error > 0) {
+        fprintf(out, ",\"errno\":%d,\"error\":", record->error);
+        json_write_string(out, strerror(record->error));
+    }
+    fputs("}\n", out);
+    funlockfile(out);
+}
+
+// 写线程：成批取出记录写入文件，每批结束后刷新一次
+void *scan_logger_thread(void *arg) {
+    ScanLogger *logger = arg;
+    time_t cached_sec = -1;
+    char timestamp[20];
+
+    while (1) {
+        int stop = __atomic_load_n(&logger->stop, __ATOMIC_ACQUIRE);
+        unsigned long written = 0;
+
+        while (1) {
+            LogSlot *slot = &logger->ring[logger->head & (LOG_RING_SIZE - 1)];
+            if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != logger->head + 1) break;
+
+            LogRecord record = slot->record;
+            __atomic_store_n(&slot->sequence, logger->head + LOG_RING_SIZE, __ATOMIC_RELEASE);
+            logger->head++;
+            written++;
+
+            if (logger->text) {
+                log_format_record(logger->text, &record, logger->categories, logger->cat_count,
+                                  &cached_sec, timestamp);
+            }
+            if (logger->binary) fwrite(&record, sizeof(record), 1, logger->binary);
+            if (logger->events) log_write_event(logger->events, &record, logger->categories, logger->cat_count);
+            range_index_add(&logger->slow_ranges, &record);
+            if (record.status >= LOG_STATUS_SEEK_ERROR || record.status == logger->cat_count - 1) {
+                range_index_add(&logger->bad_ranges, &record);
+            }
+        }
+
+        if (written > 0) {
+            if (logger->text) fflush(logger->text);
+            if (logger->binary) fflush(logger->binary);
+            if (logger->events) fflush(logger->events);
+        } else if (stop) {
+            break;  // stop 之前放入的记录都已写完
+        } else {
+            struct timespec interval = { .tv_sec = 0, .tv_nsec = LOG_FLUSH_INTERVAL_US * 1000 };
+            nanosleep(&interval, NULL);
+        }
+    }
+    return NULL;
+}
+
+// 放入一条日志记录，可由任意线程调用
+void log_block(ScanLogger *logger, unsigned long sector, int sectors, long elapsed,
+               int status, int error) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    uint64_t pos = __atomic_load_n(&logger->tail, __ATOMIC_RELAXED);
+    LogSlot *slot;
+    while (1) {
+        slot = &logger->ring[pos & (LOG_RING_SIZE - 1)];
+        uint64_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        if (sequence == pos) {
+            if (__atomic_compare_exchange_n(&logger->tail, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if ((int64_t)(sequence - pos) < 0) {
+            sched_yield();  // 队列已满，等待写线程
+            pos = __atomic_load_n(&logger->tail, __ATOMIC_RELAXED);
+        } else {
+            pos = __atomic_load_n(&logger->tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->record = (LogRecord) {
+        .sector         = sector,
+        .timestamp_ns   = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec,
+        .latency_us     = (uint32_t)elapsed,
+        .sectors        = (uint32_t)sectors,
+        .status         = (uint8_t)status,
+        .error          = (int16_t)error,
+    };
+    __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+}
+
+// 打开二进制日志。续扫时追加到已有文件之后，否则重新创建并写入文件头
+FILE *binlog_open(const char *path, const char *device, const DeviceInfo *info, size_t block_size,
+                  const TimeCategory *categories, int cat_count, int append) {
+    FILE *file = fopen(path, append ? "ab" : "wb");
+    if (!file) {
+        fprintf(stderr, "警告: 无法创建二进制日志 '%s': %s\n", path, strerror(errno));
+        return NULL;
+    }
+    if (ftell(file) > 0) return file;
+
+    BinaryLogHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINLOG_MAGIC, sizeof(header.magic));
+    header.header_size = sizeof(BinaryLogHeader);
+    header.record_size = sizeof(LogRecord);
+    header.start_sector = info->start_sector;
+    header.end_sector = info->end_sector;
+    header.block_size = block_size;
+    header.sector_size = info->sector_size;
+    header.cat_count = cat_count;
+    header.created = time(NULL);
+    snprintf(header.device, sizeof(header.device), "%s", device);
+    for (int i = 0; i < cat_count; i++) {
+        memcpy(header.category_names[i], categories[i].name, sizeof(header.category_names[i]));
+    }
+
+    if (fwrite(&header, sizeof(header), 1, file) != 1) {
+        fprintf(stderr, "警告: 无法写入二进制日志 '%s': %s\n", path, strerror(errno));
+        fclose(file);
+        return NULL;
+    }
+    return file;
+}
+
+// 启动写线程，text、binary、events 都可以为 NULL（此时只合并区间供报告使用）
+int scan_logger_start(ScanLogger *logger, FILE *text, FILE *binary, FILE *events,
+                      const TimeCategory *categories, int cat_count) {
+    memset(logger, 0, sizeof(*logger));
+    logger->ring = malloc(LOG_RING_SIZE * sizeof(LogSlot));
+    if (!logger->ring) {
+        perror("内存分配失败");
+        return -1;
+    }
+    for (uint64_t i = 0; i < LOG_RING_SIZE; i++) {
+        logger->ring[i].sequence = i;
+    }
+    logger->text = text;
+    logger->binary = binary;
+    logger->events = events;
+    logger->categories = categories;
+    logger->cat_count = cat_count;
+
+    if (pthread_create(&logger->thread, NULL, scan_logger_thread, logger) != 0) {
+        fprintf(stderr, "警告: 无法创建日志线程\n");
+        free(logger->ring);
+        logger->ring = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// 写完队列中剩余的记录后结束写线程（调用前所有扫描线程都已停止写日志）。
+// 合并好的区间保留到 scan_logger_free()
+void scan_logger_finish(ScanLogger *logger) {
+    if (!logger->ring) return;
+    __atomic_store_n(&logger->stop, 1, __ATOMIC_RELEASE);
+    pthread_join(logger->thread, NULL);
+    free(logger->ring);
+    logger->ring = NULL;
+    range_index_flush(&logger->slow_ranges);
+    range_index_flush(&logger->bad_ranges);
+}
+
+void scan_logger_free(ScanLogger *logger) {
+    scan_logger_finish(logger);
+    range_index_free(&logger->slow_ranges);
+    range_index_free(&logger->bad_ranges);
+}
+
+// 打开事件流：纯数字表示已由调用方打开的文件描述符（如 --events 3 3>events.ndjson），
+// 否则为文件路径，续扫时追加
+FILE *events_open(const char *target, int append) {
+    char *endptr;
+    long fd = strtol(target, &endptr, 10);
+    FILE *file;
+    if (*target != '\0' && *endptr == '\0' && fd >= 0) {
+        file = fdopen((int)fd, "w");
+    } else {
+        file = fopen(target, append ? "a" : "w");
+    }
+    if (!file) {
+        fprintf(stderr, "警告: 无法打开事件流 '%s': %s\n", target, strerror(errno));
+    }
+    return file;
+}
+
+// 事件流的开始事件：设备、范围和主要参数
+void events_write_start(FILE *out, const ScanOptions *opts, const DeviceInfo *info,
+                        const TimeCategory *categories, int cat_count) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    flockfile(out);
+    fprintf(out, "{\"event\":\"start\",\"time\":%.3f,\"device\":", now.tv_sec + now.tv_nsec / 1e9);
+    json_write_string(out, opts->device);
+    fprintf(out, ",\"start_sector\":%lu,\"end_sector\":%lu,\"sector_size\":%d,\"block_size\":%zu,"
+            "\"block_count\":%lu,\"sample_ratio\":%g,\"resume\":%s,\"categories\":[",
+            info->start_sector, info->end_sector, info->sector_size, opts->block_size,
+            info->block_count, opts->sample_ratio, opts->resume ? "true" : "false");
+    for (int i = 0; i < cat_count; i++) {
+        if (i > 0) fputc(',', out);
+        json_write_string(out, categories[i].name);
+    }
+    fputs("]}\n", out);
+    funlockfile(out);
+    fflush(out);
+}
+
+// 事件流的结束事件
+void events_write_end(FILE *out, int interrupted, const ScanStats *stats, const struct timespec *start_time) {
+    struct timespec now, end;
+    clock_gettime(CLOCK_REALTIME, &now);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    flockfile(out);
+    fprintf(out, "{\"event\":\"end\",\"time\":%.3f,\"result\":\"%s\",\"elapsed_sec\":%.3f,\"scanned\":%lu}\n",
+            now.tv_sec + now.tv_nsec / 1e9, interrupted ? "interrupted" : "completed",
+            timespec_diff_us(start_time, &end) / (double)US_PER_SEC, stats->scanned);
+    funlockfile(out);
+    fflush(out);
+}
+
+// 把二进制日志转换为文本日志格式输出到标准输出（log 子命令）
+int convert_binary_log(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "错误: 无法打开二进制日志 '%s': %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    BinaryLogHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, BINLOG_MAGIC, sizeof(header.magic)) != 0 ||
+        header.header_size != sizeof(BinaryLogHeader) || header.record_size != sizeof(LogRecord) ||
+        header.cat_count < 0 || header.cat_count > MAX_CATEGORIES) {
+        fprintf(stderr, "错误: '%s' 不是有效的二进制日志\n", path);
+        fclose(file);
+        return 1;
+    }
+
+    TimeCategory categories[MAX_CATEGORIES];
+    memset(categories, 0, sizeof(categories));
+    for (int i = 0; i < header.cat_count; i++) {
+        memcpy(categories[i].name, header.category_names[i], sizeof(categories[i].name));
+        categories[i].name[sizeof(categories[i].name) - 1] = '\0';
+    }
+    header.device[sizeof(header.device) - 1] = '\0';
+
+    printf("# Disk Health Scan Report\n");
+    printf("# Device: %s\n", header.device);
+    printf("# Start sector: %lu\n", (unsigned long)header.start_sector);
+    printf("# End sector: %lu\n", (unsigned long)header.end_sector);
+    printf("# Sector size: %u bytes\n", header.sector_size);
+    printf("# Block size: %lu bytes\n", (unsigned long)header.block_size);
+    printf("# Timestamp: %ld\n", (long)header.created);
+    printf("# Format: <sector> # <timestamp> # <latency> # <status>\n");
+    printf("# ================================================\n");
+
+    LogRecord records[1024];
+    time_t cached_sec = -1;
+    char timestamp[20];
+    size_t count;
+    while ((count = fread(records, sizeof(LogRecord), 1024, file)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            log_format_record(stdout, &records[i], categories, header.cat_count, &cached_sec, timestamp);
+        }
+    }
+
+    fclose(file);
+    return 0;
+}
+
+typedef struct RetestQueue RetestQueue;
+typedef struct ScanCheckpoint ScanCheckpoint;
+typedef struct ProgressRenderer ProgressRenderer;
+
+// 扫描上下文：各读取引擎共用的分类计数、可疑块处理、日志与进度路径
+typedef struct {
+    const ScanOptions  *opts;
+    const DeviceInfo   *info;
+    TimeCategory       *categories;
+    int                 cat_count;
+    ScanLogger         *logger;             // 非 NULL 时记录慢块和错误
+    ScanStats          *stats;
+    int                 fd;                 // 可疑块重测使用的设备句柄
+    void               *retest_buffer;      // 可疑块重测使用的缓冲区
+    RetestQueue        *retest_queue;       // 非 NULL 时可疑块交给后台线程重测
+    unsigned char      *latency_map;        // 非 NULL 时按块号写入量化延迟
+    unsigned char      *coverage;           // 非 NULL 时标记已扫描的块
+    ScanCheckpoint     *checkpoint;         // 非 NULL 时定期写断点
+    SampleIterator     *iterator;           // 当前引擎的采样迭代器，慢块附近加密采样时使用
+    unsigned long       iterator_base;      // 迭代器第 0 块对应的块号
+    ProgressRenderer   *progress;           // 进度显示线程，多线程引擎用它注册各工作线程的计数
+    // 以下计数（以及各分类的 count）只由所属线程以 relaxed 原子操作写入，进度线程随时读取
+    unsigned long       processed;
+    unsigned long       total_samples;
+    struct timespec     start_time;
+} ScanContext;
+
+// 进度显示：独立线程按固定的时间间隔汇总各扫描上下文的计数并刷新进度行，
+// 读取路径上只有计数的 relaxed 原子自增，设备卡住时进度行照样刷新。
+// 多线程引擎的工作线程和后台重测线程各自计数，注册为数据源后由这里求和
+struct ProgressRenderer {
+    pthread_mutex_t     lock;           // 保护数据源列表；合并计数时持有，避免同一计数被算两次
+    pthread_cond_t      wakeup;
+    const ScanContext  *sources[MAX_THREADS + 2];
+    int                 source_count;
+    const ScanContext  *main;           // 主上下文，提供分类名称和开始时间
+    int                 stop;
+    int                 started;        // 线程是否已启动
+    pthread_t           thread;
+    struct timespec     last_time;
+    unsigned long       last_processed;
+    double              rate;           // 平滑后的瞬时速度（块/秒），负数表示尚未取样
+};
+
+// 加权最小二乘拟合 速度² = a + b·x（机械硬盘面密度恒定时速度与半径成正比，速度的平方随 LBA 线性下降）。
+// 权重为 0 的点不参与；只有一个位置时无法拟合斜率，按水平线处理。没有可用的点时返回 -1
+int fit_rate_curve(const double *x, const double *rate, const double *weight, int n, double *a, double *b) {
+    double sw = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (int i = 0; i < n; i++) {
+        double w = weight[i];
+        if (w <= 0) continue;
+        double y = rate[i] * rate[i];
+        sw += w;
+        sx += w * x[i];
+        sy += w * y;
+        sxx += w * x[i] * x[i];
+        sxy += w * x[i] * y;
+    }
+    if (sw <= 0) return -1;
+    double det = sw * sxx - sx * sx;
+    *b = (det > 1e-12 * sw * sw) ? (sw * sxy - sx * sy) / det : 0;
+    *a = (sy - *b * sx) / sw;
+    return 0;
+}
+
+// 估计剩余时间（秒）。各区域的每块平均延迟乘以实测墙钟时间与延迟总和之比（反映队列深度、多线程、
+// 等待因子和重测带来的并行与额外开销），再按各区域的剩余样本数求和。剩余样本按区域大小分摊，减去已扫描的部分。
+// 还没有数据的区域：机械硬盘按外圈到内圈的速度曲线外推（面密度恒定时速度与半径成正比，
+// 速度的平方随 LBA 线性下降，按块数加权做最小二乘拟合），其他设备取已测区域的平均值
+double estimate_remaining_sec(const unsigned long *zone_blocks, const unsigned long *zone_latency_us,
+                              unsigned long block_count, unsigned long processed, unsigned long total,
+                              double elapsed_sec, int rotational) {
+    if (processed >= total) return 0;
+    double average_sec = (processed > 0) ? (total - processed) * elapsed_sec / processed : 0;
+
+    double sum_blocks = 0, sum_latency = 0;
+    for (int i = 0; i < ETA_ZONES; i++) {
+        sum_blocks += zone_blocks[i];
+        sum_latency += zone_latency_us[i];
+    }
+    if (sum_blocks < ETA_ZONE_MIN_BLOCKS || sum_latency <= 0 || elapsed_sec <= 0) return average_sec;
+    double scale = elapsed_sec * US_PER_SEC / sum_latency;
+    double mean_cost = sum_latency / sum_blocks;
+
+    // 机械硬盘：拟合 速度² = a + b·x，x 为区域中心在扫描范围中的位置（0~1）
+    double fit_a = 0, fit_b = 0, max_rate_sq = 0;
+    int fitted = 0;
+    if (rotational) {
+        double x[ETA_ZONES], rate[ETA_ZONES], weight[ETA_ZONES];
+        for (int i = 0; i < ETA_ZONES; i++) {
+            int measured = zone_blocks[i] >= ETA_ZONE_MIN_BLOCKS && zone_latency_us[i] > 0;
+            x[i] = (i + 0.5) / ETA_ZONES;
+            rate[i] = measured ? (double)zone_blocks[i] / zone_latency_us[i] : 0;
+            weight[i] = measured ? zone_blocks[i] : 0;
+            if (rate[i] * rate[i] > max_rate_sq) max_rate_sq = rate[i] * rate[i];
+        }
+        fitted = fit_rate_curve(x, rate, weight, ETA_ZONES, &fit_a, &fit_b) == 0;
+    }
+
+    double remaining[ETA_ZONES];
+    double cost[ETA_ZONES];
+    double remaining_sum = 0;
+    for (int i = 0; i < ETA_ZONES; i++) {
+        unsigned long zone_size = block_count * (i + 1) / ETA_ZONES - block_count * i / ETA_ZONES;
+        double expected = (double)total * zone_size / block_count;
+        remaining[i] = expected > zone_blocks[i] ? expected - zone_blocks[i] : 0;
+        remaining_sum += remaining[i];
+
+        if (zone_blocks[i] >= ETA_ZONE_MIN_BLOCKS) {
+            cost[i] = (double)zone_latency_us[i] / zone_blocks[i];
+        } else if (fitted) {
+            double rate_sq = fit_a + fit_b * (i + 0.5) / ETA_ZONES;
+            double min_rate_sq = ETA_MIN_INNER_RATIO * ETA_MIN_INNER_RATIO * max_rate_sq;
+            if (rate_sq < min_rate_sq) rate_sq = min_rate_sq;
+            if (rate_sq > max_rate_sq) rate_sq = max_rate_sq;
+            cost[i] = 1 / sqrt(rate_sq);
+        } else {
+            cost[i] = mean_cost;
+        }
+    }
+    if (remaining_sum <= 0) return average_sec;
+
+    // 剩余样本总数以迭代器为准，各区域按比例分摊
+    double norm = (double)(total - processed) / remaining_sum;
+    double remaining_us = 0;
+    for (int i = 0; i < ETA_ZONES; i++) {
+        remaining_us += remaining[i] * norm * cost[i];
+    }
+    return remaining_us * scale / US_PER_SEC;
+}
+
+// 汇总各数据源的计数并刷新进度行，final 为 1 时按已扫描的块数显示 100%
+void progress_render(ProgressRenderer *progress, int final) {
+    const ScanContext *main_ctx = progress->main;
+    const TimeCategory *cats = main_ctx->categories;
+    int cat_count = main_ctx->cat_count;
+    long counts[MAX_CATEGORIES] = { 0 };
+    unsigned long zone_blocks[ETA_ZONES] = { 0 };
+    unsigned long zone_latency_us[ETA_ZONES] = { 0 };
+    unsigned long processed = 0;
+    unsigned long total = 0;
+
+    pthread_mutex_lock(&progress->lock);
+    for (int i = 0; i < progress->source_count; i++) {
+        const ScanContext *source = progress->sources[i];
+        processed += __atomic_load_n(&source->processed, __ATOMIC_RELAXED);
+        total += __atomic_load_n(&source->total_samples, __ATOMIC_RELAXED);
+        for (int j = 0; j < cat_count; j++) {
+            counts[j] += __atomic_load_n(&source->categories[j].count, __ATOMIC_RELAXED);
+        }
+        for (int j = 0; j < ETA_ZONES; j++) {
+            zone_blocks[j] += __atomic_load_n(&source->stats->zone_blocks[j], __ATOMIC_RELAXED);
+            zone_latency_us[j] += __atomic_load_n(&source->stats->zone_latency_us[j], __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&progress->lock);
+    if (final || total < processed) total = processed;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed_sec = timespec_diff_us(&main_ctx->start_time, &now) / (double)US_PER_SEC;
+    double interval_sec = timespec_diff_us(&progress->last_time, &now) / (double)US_PER_SEC;
+    // 间隔太短时（例如扫描刚结束）瞬时速度没有意义，保留上一次的值
+    if (interval_sec >= PROGRESS_INTERVAL_US / 5 / (double)US_PER_SEC) {
+        double instant = (processed - progress->last_processed) / interval_sec;
+        if (progress->rate < 0) {
+            progress->rate = instant;
+        } else {
+            progress->rate += (1 - exp(-interval_sec / PROGRESS_EWMA_TAU_SEC)) * (instant - progress->rate);
+        }
+        progress->last_time = now;
+        progress->last_processed = processed;
+    }
+
+    double rate = progress->rate > 0 ? progress->rate : 0;
+    double average = (elapsed_sec > 0) ? processed / elapsed_sec : 0;
+    double mb_per_block = (double)main_ctx->opts->block_size / (1024 * 1024);
+    double progress_pct = (total > 0) ? 100.0 * processed / total : 0.0;
+    double remaining_sec = estimate_remaining_sec(zone_blocks, zone_latency_us, main_ctx->info->block_count,
+                                                  processed, total, elapsed_sec, main_ctx->opts->rotational);
+
+    printf("\r进度: %5.1f%% | 速度: %.1f MB/s %.0f IOPS (平均 %.1f MB/s %.0f IOPS) | 剩余: %dh%02dm%02ds | ",
+           progress_pct, rate * mb_per_block, rate, average * mb_per_block, average,
+           (int)(remaining_sec / 3600), (int)(remaining_sec) % 3600 / 60, (int)remaining_sec % 60);
+
+    for (int i = 0; i < cat_count; i++) {
+        if (counts[i] > 0) {
+            printf("%s%s\033[0m: %ld ", cats[i].color, cats[i].name, counts[i]);
+        } else {
+            printf("%s: %ld ", cats[i].name, counts[i]);
+        }
+    }
+
+    printf("\033[K");
+    fflush(stdout);
+
+    FILE *events = main_ctx->logger ? main_ctx->logger->events : NULL;
+    if (events) {
+        struct timespec wall;
+        clock_gettime(CLOCK_REALTIME, &wall);
+        flockfile(events);  // 慢块事件由日志线程写入，保证每行完整
+        fprintf(events, "{\"event\":\"progress\",\"time\":%.3f,\"elapsed_sec\":%.3f,\"processed\":%lu,"
+                "\"total\":%lu,\"percent\":%.3f,\"iops\":%.1f,\"mb_per_sec\":%.3f,\"avg_iops\":%.1f,"
+                "\"avg_mb_per_sec\":%.3f,\"eta_sec\":%.1f,\"final\":%s,\"counts\":{",
+                wall.tv_sec + wall.tv_nsec / 1e9, elapsed_sec, processed, total, progress_pct,
+                rate, rate * mb_per_block, average, average * mb_per_block, remaining_sec,
+                final ? "true" : "false");
+        for (int i = 0; i < cat_count; i++) {
+            if (i > 0) fputc(',', events);
+            json_write_string(events, cats[i].name);
+            fprintf(events, ":%ld", counts[i]);
+        }
+        fputs("}}\n", events);
+        funlockfile(events);
+        fflush(events);
+    }
+}
+
+// 进度线程：按固定的时间间隔刷新，不依赖读取完成的节奏
+void *progress_renderer_thread(void *arg) {
+    ProgressRenderer *progress = arg;
+
+    pthread_mutex_lock(&progress->lock);
+    while (!progress->stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        timespec_add_us(&deadline, PROGRESS_INTERVAL_US);
+        int rc = 0;
+        while (!progress->stop && rc != ETIMEDOUT) {
+            rc = pthread_cond_timedwait(&progress->wakeup, &progress->lock, &deadline);
+        }
+        if (progress->stop) break;
+
+        pthread_mutex_unlock(&progress->lock);
+        progress_render(progress, 0);
+        pthread_mutex_lock(&progress->lock);
+    }
+    pthread_mutex_unlock(&progress->lock);
+
+    return NULL;
+}
+
+// 显示初始进度并启动进度线程，ctx 作为第一个数据源。
+// 线程创建失败时扫描照常进行，只是中途不刷新进度
+void progress_renderer_start(ProgressRenderer *progress, const ScanContext *ctx) {
+    memset(progress, 0, sizeof(*progress));
+    pthread_mutex_init(&progress->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&progress->wakeup, &attr);
+    pthread_condattr_destroy(&attr);
+
+    progress->main = ctx;
+    progress->sources[progress->source_count++] = ctx;
+    clock_gettime(CLOCK_MONOTONIC, &progress->last_time);
+    progress->last_processed = ctx->processed;
+    progress->rate = -1;
+    progress_render(progress, 0);
+
+    if (pthread_create(&progress->thread, NULL, progress_renderer_thread, progress) == 0) {
+        progress->started = 1;
+    } else {
+        fprintf(stderr, "\n警告: 无法创建进度显示线程，扫描期间不刷新进度\n");
+    }
+}
+
+// 注册数据源（多线程引擎的工作线程、后台重测线程），返回注册前的数据源个数，
+// 之后在持有 lock 时把计数合并到主上下文，并把 source_count 恢复为该值
+int progress_add_source(ProgressRenderer *progress, const ScanContext *source) {
+    pthread_mutex_lock(&progress->lock);
+    int index = progress->source_count;
+    if (index < MAX_THREADS + 2) progress->sources[progress->source_count++] = source;
+    pthread_mutex_unlock(&progress->lock);
+    return index;
+}
+
+// 停止进度线程，此后可以在调用线程上直接 progress_render()
+void progress_renderer_stop(ProgressRenderer *progress) {
+    if (!progress->started) return;
+    pthread_mutex_lock(&progress->lock);
+    progress->stop = 1;
+    pthread_cond_signal(&progress->wakeup);
+    pthread_mutex_unlock(&progress->lock);
+    pthread_join(progress->thread, NULL);
+    progress->started = 0;
+}
+
+void progress_renderer_destroy(ProgressRenderer *progress) {
+    progress_renderer_stop(progress);
+    pthread_mutex_destroy(&progress->lock);
+    pthread_cond_destroy(&progress->wakeup);
+}
+
+// 序贯判定的边界，0 表示固定读满 -R 次
+long retest_boundary(const ScanContext *ctx) {
+    return ctx->opts->adaptive_retest ? ctx->opts->suspect_threshold : 0;
+}
+
+// 重测次数上限，至少需要3次才能去掉最大最小值
+int retest_max_reads(const ScanContext *ctx) {
+    return ctx->opts->suspect_retries < 3 ? 3 : ctx->opts->suspect_retries;
+}
+
+// 可疑块重测函数：重测单个区间，返回平均延迟（微秒），读取失败时返回 -1
+long retest_suspect_block(ScanContext *ctx, off_t offset, size_t size) {
+    int retries = retest_max_reads(ctx);
+
+    RetestJob job = { .offset = offset, .size = size };
+    job.samples = malloc(retries * sizeof(long));
+    if (!job.samples) return -1;
+
+    run_retest_jobs(ctx->fd, ctx->retest_buffer, ctx->info, &job, 1, retries,
+                    ctx->opts->suspect_interval, retest_boundary(ctx));
+    ctx->stats->retested++;
+    ctx->stats->retest_reads += job.sample_count + job.failed;
+    long result = retest_job_result(&job);
+
+    free(job.samples);
+    return result;
+}
+
+// 记录分层扫描定位到的最小粒度区间，result 为最终延迟（微秒），-1 表示读取失败
+long record_located_extent(ScanContext *ctx, unsigned long sector, int sectors, long result) {
+    const ScanOptions *opts = ctx->opts;
+    int status;
+
+    if (result < 0) {
+        ctx->stats->located_errors++;
+        status = LOG_STATUS_READ_ERROR;
+    } else {
+        if (result > opts->suspect_threshold) ctx->stats->located_slow++;
+        status = find_category(ctx->categories, ctx->cat_count, result);
+    }
+
+    if (ctx->logger && (result < 0 || result > opts->log_threshold)) {
+        log_block(ctx->logger, sector, sectors, result < 0 ? LATENCY_ERROR_US : result, status, 0);
+    }
+    return result;
+}
+
+// 分层扫描：把读取失败或超过可疑阈值的区间递归二分到细分粒度，定位真正的慢/坏扇区。
+// sector 为绝对扇区号。返回区间内最差的最终延迟（微秒），存在读取失败的扇区时返回 -1
+long bisect_extent(ScanContext *ctx, unsigned long sector, int sectors) {
+    const ScanOptions *opts = ctx->opts;
+    const DeviceInfo *info = ctx->info;
+    int fine_sectors = opts->fine_block_size / info->sector_size;
+
+    if (sectors <= fine_sectors) {
+        // 最小粒度的慢区间：与普通可疑块一样多次重测确认
+        long result = retest_suspect_block(ctx, (off_t)sector * info->sector_size,
+                                           (size_t)sectors * info->sector_size);
+        return record_located_extent(ctx, sector, sectors, result);
+    }
+
+    int half = sectors / 2;
+    size_t half_size = (size_t)half * info->sector_size;
+    long worst = 0;
+    int failed = 0;
+
+    for (int i = 0; i < 2; i++) {
+        unsigned long part = sector + (unsigned long)i * half;
+        struct timespec start, end;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        ssize_t bytes_read = pread(ctx->fd, ctx->retest_buffer, half_size, (off_t)part * info->sector_size);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ctx->stats->bisect_reads++;
+
+        long result = timespec_diff_us(&start, &end);
+        if (bytes_read != (ssize_t)half_size && half <= fine_sectors) {
+            // 最小粒度读取失败无需再重测
+            result = record_located_extent(ctx, part, half, -1);
+        } else if (bytes_read != (ssize_t)half_size || result > opts->suspect_threshold) {
+            result = bisect_extent(ctx, part, half);
+        }
+
+        if (result < 0) {
+            failed = 1;
+        } else if (result > worst) {
+            worst = result;
+        }
+    }
+
+    return failed ? -1 : worst;
+}
+
+// 计入可疑块重测后的最终分类并写日志，retest_result 为 -1 表示读取失败
+// 返回最终延迟（微秒），读取失败时返回 LATENCY_ERROR_US
+long finish_suspect_block(ScanContext *ctx, unsigned long block, long retest_result,
+                          const char *error_status) {
+    const ScanOptions *opts = ctx->opts;
+    const DeviceInfo *info = ctx->info;
+    int status;
+    long elapsed;
+
+    if (retest_result < 0) {
+        status = error_status ? log_status_code(error_status) : LOG_STATUS_READ_ERROR;
+        elapsed = LATENCY_ERROR_US;
+        if (ctx->latency_map) ctx->latency_map[block] = LATENCY_MAP_ERROR;
+    } else {
+        if (ctx->latency_map) ctx->latency_map[block] = latency_map_encode(retest_result);
+        // 重测后重新分类
+        int status_index = find_category(ctx->categories, ctx->cat_count, retest_result);
+        __atomic_fetch_add(&ctx->categories[status_index].count, 1, __ATOMIC_RELAXED);
+        status = status_index;
+        elapsed = retest_result;
+    }
+
+    if (ctx->logger && elapsed > opts->log_threshold) {
+        log_block(ctx->logger, block * info->sectors_per_block + info->sector_offset,
+                  info->sectors_per_block, elapsed, status, 0);
+    }
+
+    return elapsed;
+}
+
+// 块的字节偏移
+off_t block_offset(const DeviceInfo *info, unsigned long block) {
+    return (off_t)(block * info->sectors_per_block + info->sector_offset) * info->sector_size;
+}
+
+// 对可疑块做最终判定：重测（分层扫描时为二分定位）、计入最终分类并写日志
+// 返回最终延迟（微秒），读取失败时返回 LATENCY_ERROR_US
+long resolve_suspect_block(ScanContext *ctx, unsigned long block, const char *error_status) {
+    const ScanOptions *opts = ctx->opts;
+    const DeviceInfo *info = ctx->info;
+
+    long retest_result;
+    if (opts->fine_block_size > 0) {
+        // 分层扫描：二分定位块内的慢/坏扇区
+        retest_result = bisect_extent(ctx, block * info->sectors_per_block + info->sector_offset,
+                                      info->sectors_per_block);
+    } else {
+        // 进行重测
+        retest_result = retest_suspect_block(ctx, block_offset(info, block), opts->block_size);
+    }
+
+    return finish_suspect_block(ctx, block, retest_result, error_status);
+}
+
+// 待重测的可疑块
+typedef struct {
+    unsigned long   block;
+    const char     *error_status;   // 首次读取失败的原因，NULL 表示首次读取成功但偏慢
+} SuspectEntry;
+
+// 交错重测一批可疑块：各块的重测轮流进行，彼此充当冲刷读取
+void resolve_suspect_batch(ScanContext *ctx, const SuspectEntry *entries, int count) {
+    const ScanOptions *opts = ctx->opts;
+    int retries = retest_max_reads(ctx);
+
+    RetestJob jobs[RETEST_BATCH];
+    long *samples = NULL;
+    if (opts->fine_block_size == 0 && count > 1) {
+        samples = malloc((size_t)count * retries * sizeof(long));
+    }
+    if (!samples) {
+        // 分层扫描按块二分定位，无法交错
+        for (int i = 0; i < count; i++) {
+            resolve_suspect_block(ctx, entries[i].block, entries[i].error_status);
+        }
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        jobs[i] = (RetestJob){
+            .offset  = block_offset(ctx->info, entries[i].block),
+            .size    = opts->block_size,
+            .samples = samples + (size_t)i * retries,
+        };
+    }
+    run_retest_jobs(ctx->fd, ctx->retest_buffer, ctx->info, jobs, count,
+                    retries, opts->suspect_interval, retest_boundary(ctx));
+    for (int i = 0; i < count; i++) {
+        ctx->stats->retested++;
+        ctx->stats->retest_reads += jobs[i].sample_count + jobs[i].failed;
+        finish_suspect_block(ctx, entries[i].block, retest_job_result(&jobs[i]),
+                             entries[i].error_status);
+    }
+
+    free(samples);
+}
+
+// 异步可疑块重测队列：扫描线程只负责入队，后台线程使用独立的句柄重测，
+// 并把最终分类计入自己的计数，扫描结束后合并
+struct RetestQueue {
+    pthread_mutex_t     lock;
+    pthread_cond_t      not_empty;
+    pthread_cond_t      idle_changed;
+    SuspectEntry       *entries;        // 环形缓冲区，满时扩容
+    size_t              capacity;
+    size_t              head;
+    size_t              count;
+    int                 closing;
+    int                 pause_requested;    // 写断点期间暂停重测
+    int                 idle;               // 重测线程正在等待，不持有任何可疑块
+    unsigned long       completed;
+    ScanContext         ctx;
+    TimeCategory        categories[MAX_CATEGORIES];
+    ScanStats           stats;
+    pthread_t           thread;
+};
+
+// 可疑块入队，不会阻塞扫描线程等待重测
+void retest_queue_push(RetestQueue *queue, unsigned long block, const char *error_status) {
+    pthread_mutex_lock(&queue->lock);
+
+    if (queue->count == queue->capacity) {
+        size_t new_capacity = queue->capacity ? queue->capacity * 2 : 1024;
+        SuspectEntry *entries = malloc(new_capacity * sizeof(SuspectEntry));
+        if (!entries) {
+            pthread_mutex_unlock(&queue->lock);
+            fprintf(stderr, "警告: 重测队列内存不足，放弃重测块 %lu\n", block);
+            return;
+        }
+        for (size_t i = 0; i < queue->count; i++) {
+            entries[i] = queue->entries[(queue->head + i) % queue->capacity];
+        }
+        free(queue->entries);
+        queue->entries = entries;
+        queue->capacity = new_capacity;
+        queue->head = 0;
+    }
+
+    SuspectEntry *entry = &queue->entries[(queue->head + queue->count) % queue->capacity];
+    entry->block = block;
+    entry->error_status = error_status;
+    queue->count++;
+
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+// 后台重测线程
+void *retest_queue_thread(void *arg) {
+    RetestQueue *queue = arg;
+
+    pthread_mutex_lock(&queue->lock);
+    while (1) {
+        while ((queue->count == 0 && !queue->closing) || queue->pause_requested) {
+            queue->idle = 1;
+            pthread_cond_broadcast(&queue->idle_changed);
+            pthread_cond_wait(&queue->not_empty, &queue->lock);
+        }
+        queue->idle = 0;
+        if (queue->count == 0) break;
+
+        // 一次取出一批，交错重测
+        SuspectEntry batch[RETEST_BATCH];
+        int batch_count = 0;
+        while (batch_count < RETEST_BATCH && queue->count > 0) {
+            batch[batch_count++] = queue->entries[queue->head];
+            queue->head = (queue->head + 1) % queue->capacity;
+            queue->count--;
+        }
+        pthread_mutex_unlock(&queue->lock);
+
+        resolve_suspect_batch(&queue->ctx, batch, batch_count);
+
+        pthread_mutex_lock(&queue->lock);
+        queue->completed += batch_count;
+    }
+    queue->idle = 1;
+    pthread_cond_broadcast(&queue->idle_changed);
+    pthread_mutex_unlock(&queue->lock);
+
+    return NULL;
+}
+
+// 启动重测线程，成功返回 0；失败时调用方应继续使用同步重测
+int retest_queue_start(RetestQueue *queue, const ScanContext *parent, const char *device) {
+    const DeviceInfo *info = parent->info;
+
+    memset(queue, 0, sizeof(*queue));
+    queue->ctx = *parent;
+    queue->ctx.categories = queue->categories;
+    queue->ctx.stats = &queue->stats;
+    queue->ctx.retest_queue = NULL;
+    memcpy(queue->categories, parent->categories, sizeof(TimeCategory) * parent->cat_count);
+    for (int j = 0; j < parent->cat_count; j++) {
+        queue->categories[j].count = 0;
+    }
+    scan_stats_init(&queue->stats);
+
+    queue->ctx.fd = open(device, O_RDONLY | O_DIRECT | O_SYNC);
+    if (queue->ctx.fd == -1) {
+        fprintf(stderr, "警告: 无法为重测线程打开设备 (%s)，改为同步重测\n", strerror(errno));
+        return -1;
+    }
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    size_t align_size = (info->sector_size > page_size) ? info->sector_size : page_size;
+    if (posix_memalign(&queue->ctx.retest_buffer, align_size, parent->opts->block_size)) {
+        perror("内存分配失败");
+        close(queue->ctx.fd);
+        return -1;
+    }
+
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->idle_changed, NULL);
+    if (pthread_create(&queue->thread, NULL, retest_queue_thread, queue) != 0) {
+        fprintf(stderr, "警告: 无法创建重测线程，改为同步重测\n");
+        pthread_mutex_destroy(&queue->lock);
+        pthread_cond_destroy(&queue->not_empty);
+        pthread_cond_destroy(&queue->idle_changed);
+        free(queue->ctx.retest_buffer);
+        close(queue->ctx.fd);
+        return -1;
+    }
+
+    return 0;
+}
+
+// 暂停重测线程：等它处理完手上的一批后停下，此后队列内容和重测计数不再变化
+void retest_queue_pause(RetestQueue *queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->pause_requested = 1;
+    while (!queue->idle) {
+        pthread_cond_wait(&queue->idle_changed, &queue->lock);
+    }
+    pthread_mutex_unlock(&queue->lock);
+}
+
+// 恢复重测线程
+void retest_queue_resume(RetestQueue *queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->pause_requested = 0;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+// 等待队列中剩余的可疑块重测完成，并把结果合并到 parent。
+// discard 为 1 时（扫描被中断，剩余可疑块已保存在断点中）丢弃尚未开始的重测
+void retest_queue_finish(RetestQueue *queue, ScanContext *parent, int discard) {
+    pthread_mutex_lock(&queue->lock);
+    if (discard) queue->count = 0;
+    size_t pending = queue->count;
+    queue->closing = 1;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+
+    if (pending > 0) {
+        printf("\n\033[1;37m【采样策略】\033[m扫描完成，等待 %zu 个可疑块重测...", pending);
+        fflush(stdout);
+    }
+    pthread_join(queue->thread, NULL);
+
+    for (int j = 0; j < parent->cat_count; j++) {
+        parent->categories[j].count += queue->categories[j].count;
+    }
+    scan_stats_merge(parent->stats, &queue->stats);
+
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->idle_changed);
+    free(queue->entries);
+    free(queue->ctx.retest_buffer);
+    close(queue->ctx.fd);
+}
+
+// 断点文件：文件头之后依次是各采样迭代器的状态和尚未重测的可疑块。
+// 直接保存内存中的结构体，只保证同一版本程序之间可以续扫
+#define CHECKPOINT_MAGIC    "GBCKPT01"
+
+typedef struct {
+    char            magic[8];
+    // 扫描参数，续扫时必须与当前参数一致
+    uint64_t        start_sector;
+    uint64_t        end_sector;
+    uint64_t        block_size;
+    uint64_t        fine_block_size;
+    uint64_t        block_count;
+    double          sample_ratio;
+    int32_t         random_sampling;
+    int32_t         cat_count;
+    uint64_t        seed;               // 随机种子，续扫时沿用（迭代器中保存了发生器状态）
+    int32_t         iterator_count;     // 1 为同步/io_uring 引擎，大于 1 为多线程引擎的线程数
+    uint32_t        pending_count;
+    // 扫描进度
+    uint64_t        processed;
+    int64_t         elapsed_us;         // 之前各次运行累计的扫描时间
+    uint64_t        category_counts[MAX_CATEGORIES];
+    ScanStats       stats;
+} CheckpointHeader;
+
+typedef struct {
+    uint64_t        block_base;
+    SampleIterator  iterator;
+} CheckpointIterator;
+
+typedef struct {
+    uint64_t        block;
+    int32_t         status;             // 0=首次读取偏慢，1=读取错误，2=定位错误
+    int32_t         reserved;
+} CheckpointSuspect;
+
+struct ScanCheckpoint {
+    const char         *path;
+    int                 interval;       // 秒
+    struct timespec     last_save;
+    // 续扫时从文件载入的状态
+    CheckpointHeader    header;
+    CheckpointIterator *iterators;
+    CheckpointSuspect  *pending;
+};
+
+// 收到 SIGINT/SIGTERM 后置位，各引擎写完断点后退出
+volatile sig_atomic_t scan_interrupted = 0;
+
+void handle_interrupt(int sig) {
+    (void)sig;
+    scan_interrupted = 1;
+}
+
+// 安装中断处理：第一次 Ctrl-C 保存断点后退出，再按一次恢复默认行为立即终止
+void install_interrupt_handler(void) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_interrupt;
+    sa.sa_flags = SA_RESETHAND;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+}
+
+const char *checkpoint_status_name(int32_t status) {
+    if (status == 1) return "读取错误";
+    if (status == 2) return "定位错误";
+    return NULL;
+}
+
+int32_t checkpoint_status_code(const char *error_status) {
+    if (!error_status) return 0;
+    return strcmp(error_status, "定位错误") == 0 ? 2 : 1;
+}
+
+// 读取并校验断点文件，成功返回 0
+int checkpoint_load(ScanCheckpoint *ckpt, const ScanOptions *opts, const DeviceInfo *info,
+                    int cat_count) {
+    FILE *file = fopen(ckpt->path, "rb");
+    if (!file) {
+        fprintf(stderr, "错误: 无法打开断点文件 '%s': %s\n", ckpt->path, strerror(errno));
+        return -1;
+    }
+
+    CheckpointHeader *header = &ckpt->header;
+    if (fread(header, sizeof(*header), 1, file) != 1 ||
+        memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->iterator_count < 1 || header->iterator_count > MAX_THREADS) {
+        fprintf(stderr, "错误: '%s' 不是有效的断点文件\n", ckpt->path);
+        fclose(file);
+        return -1;
+    }
+
+    if (header->start_sector != info->start_sector || header->end_sector != info->end_sector ||
+        header->block_size != opts->block_size || header->fine_block_size != opts->fine_block_size ||
+        header->block_count != info->block_count || header->sample_ratio != opts->sample_ratio ||
+        header->random_sampling != opts->random_sampling || header->cat_count != cat_count) {
+        fprintf(stderr, "错误: 断点文件与当前扫描参数不一致（范围、块大小、采样方式或分类配置）\n");
+        fclose(file);
+        return -1;
+    }
+
+    ckpt->iterators = malloc(header->iterator_count * sizeof(CheckpointIterator));
+    ckpt->pending = malloc((header->pending_count + 1) * sizeof(CheckpointSuspect));
+    if (!ckpt->iterators || !ckpt->pending ||
+        fread(ckpt->iterators, sizeof(CheckpointIterator), header->iterator_count, file)
+            != (size_t)header->iterator_count ||
+        fread(ckpt->pending, sizeof(CheckpointSuspect), header->pending_count, file)
+            != header->pending_count) {
+        fprintf(stderr, "错误: 断点文件 '%s' 不完整\n", ckpt->path);
+        free(ckpt->iterators);
+        free(ckpt->pending);
+        ckpt->iterators = NULL;
+        ckpt->pending = NULL;
+        fclose(file);
+        return -1;
+    }
+
+    fclose(file);
+
+    // 迭代器中的位图指针只在原进程内有效，这里只检查模式是否一致，续扫时重新指向
+    for (int i = 0; i < header->iterator_count; i++) {
+        if ((ckpt->iterators[i].iterator.coverage != NULL) != (opts->coverage_file != NULL)) {
+            fprintf(stderr, "错误: 断点与当前参数不一致：%s指定覆盖位图\n",
+                    opts->coverage_file ? "断点未" : "断点需要");
+            free(ckpt->iterators);
+            free(ckpt->pending);
+            ckpt->iterators = NULL;
+            ckpt->pending = NULL;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// 把断点中的分类计数和统计恢复到本次运行，scan_start 提前到逻辑扫描的开始时间
+void checkpoint_restore(const ScanCheckpoint *ckpt, TimeCategory *categories, int cat_count,
+                        ScanStats *stats, struct timespec *scan_start) {
+    const CheckpointHeader *header = &ckpt->header;
+    char latency[32];
+
+    for (int j = 0; j < cat_count; j++) {
+        categories[j].count = header->category_counts[j];
+    }
+    *stats = header->stats;
+    timespec_sub_us(scan_start, header->elapsed_us);
+
+    printf("\033[33m【断点续扫】\033[m已扫描 %lu 块，已用时 %s，待重测可疑块 %u 个\n",
+           (unsigned long)header->processed,
+           format_latency(header->elapsed_us, latency, sizeof(latency)), header->pending_count);
+}
+
+// 是否应当写断点：到了保存间隔或扫描被中断
+int checkpoint_due(const ScanContext *ctx) {
+    const ScanCheckpoint *ckpt = ctx->checkpoint;
+    if (!ckpt) return 0;
+    if (scan_interrupted) return 1;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec - ckpt->last_save.tv_sec >= ckpt->interval;
+}
+
+// 写断点。调用方须保证所有扫描线程都停在块与块之间；重测线程在这里暂停。
+// parts 为多线程引擎中各工作线程的上下文，其计数与 ctx 的计数相加后保存。
+// 先写临时文件再 rename，任何时刻中断都不会留下损坏的断点
+int checkpoint_write(ScanContext *ctx, const CheckpointIterator *iterators, int iterator_count,
+                     ScanContext *const *parts, int part_count) {
+    ScanCheckpoint *ckpt = ctx->checkpoint;
+    const ScanOptions *opts = ctx->opts;
+    const DeviceInfo *info = ctx->info;
+    RetestQueue *queue = ctx->retest_queue;
+
+    if (queue) retest_queue_pause(queue);
+
+    static CheckpointHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.start_sector    = info->start_sector;
+    header.end_sector      = info->end_sector;
+    header.block_size      = opts->block_size;
+    header.fine_block_size = opts->fine_block_size;
+    header.block_count     = info->block_count;
+    header.sample_ratio    = opts->sample_ratio;
+    header.random_sampling = opts->random_sampling;
+    header.seed = opts->seed;
+    header.cat_count       = ctx->cat_count;
+    header.iterator_count  = iterator_count;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    header.elapsed_us = timespec_diff_us(&ctx->start_time, &now);
+
+    header.processed = ctx->processed;
+    header.stats = *ctx->stats;
+    for (int j = 0; j < ctx->cat_count; j++) {
+        header.category_counts[j] = ctx->categories[j].count;
+    }
+    for (int i = 0; i < part_count; i++) {
+        header.processed += parts[i]->processed;
+        scan_stats_merge(&header.stats, parts[i]->stats);
+        for (int j = 0; j < ctx->cat_count; j++) {
+            header.category_counts[j] += parts[i]->categories[j].count;
+        }
+    }
+
+    CheckpointSuspect *pending = NULL;
+    if (queue) {
+        scan_stats_merge(&header.stats, &queue->stats);
+        for (int j = 0; j < ctx->cat_count; j++) {
+            header.category_counts[j] += queue->categories[j].count;
+        }
+        pending = malloc((queue->count + 1) * sizeof(CheckpointSuspect));
+        if (pending) {
+            header.pending_count = queue->count;
+            for (size_t i = 0; i < queue->count; i++) {
+                const SuspectEntry *entry = &queue->entries[(queue->head + i) % queue->capacity];
+                pending[i] = (CheckpointSuspect){
+                    .block  = entry->block,
+                    .status = checkpoint_status_code(entry->error_status),
+                };
+            }
+        }
+    }
+
+    if (queue) retest_queue_resume(queue);
+
+    int result = -1;
+    size_t path_len = strlen(ckpt->path);
+    char *tmp_path = malloc(path_len + 5);
+    if (tmp_path && (!queue || pending)) {
+        snprintf(tmp_path, path_len + 5, "%s.tmp", ckpt->path);
+        FILE *file = fopen(tmp_path, "wb");
+        if (file) {
+            int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                     fwrite(iterators, sizeof(CheckpointIterator), iterator_count, file)
+                         == (size_t)iterator_count &&
+                     fwrite(pending, sizeof(CheckpointSuspect), header.pending_count, file)
+                         == header.pending_count &&
+                     fflush(file) == 0 && fsync(fileno(file)) == 0;
+            if (fclose(file) == 0 && ok && rename(tmp_path, ckpt->path) == 0) {
+                result = 0;
+            } else {
+                unlink(tmp_path);
+            }
+        }
+    }
+    if (result != 0) {
+        fprintf(stderr, "\n警告: 无法写入断点文件 '%s': %s\n", ckpt->path, strerror(errno));
+    }
+
+    free(tmp_path);
+    free(pending);
+    ckpt->last_save = now;
+    return result;
+}
+
+// 采样结束后等待队列中剩余的可疑块重测完成，期间仍定期写断点（迭代器已耗尽，
+// 断点中只剩待重测的可疑块）。返回 0 表示完成，1 表示被中断（断点已保存）
+int retest_queue_drain(RetestQueue *queue, ScanContext *parent, const SampleIterator *exhausted) {
+    pthread_mutex_lock(&queue->lock);
+    size_t pending = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    if (pending > 0) {
+        printf("\n\033[1;37m【采样策略】\033[m扫描完成，等待 %zu 个可疑块重测...", pending);
+        fflush(stdout);
+    }
+
+    while (1) {
+        pthread_mutex_lock(&queue->lock);
+        int busy = queue->count > 0 || !queue->idle;
+        pthread_mutex_unlock(&queue->lock);
+        if (!busy) return 0;
+
+        if (checkpoint_due(parent)) {
+            CheckpointIterator state = { .block_base = 0, .iterator = *exhausted };
+            checkpoint_write(parent, &state, 1, NULL, 0);
+            if (scan_interrupted) return 1;
+        }
+
+        struct timespec interval = { .tv_sec = 0, .tv_nsec = 50000000 };
+        nanosleep(&interval, NULL);
+    }
+}
+
+// 记录单个块的读取结果，error_status 非 NULL 表示读取失败，此时 errno 为失败原因（0 表示读取不完整）
+// 返回用于等待时间计算的耗时（同步重测时为重测结果）
+long record_block_result(ScanContext *ctx, unsigned long block, long elapsed,
+                         const char *error_status) {
+    const ScanOptions *opts = ctx->opts;
+    const DeviceInfo *info = ctx->info;
+    TimeCategory *categories = ctx->categories;
+    int cat_count = ctx->cat_count;
+    int error = error_status ? errno : 0;   // 读取失败的原因，调用方保证 errno 有效
+
+    __atomic_fetch_add(&ctx->processed, 1, __ATOMIC_RELAXED);
+    ctx->stats->scanned++;
+    ctx->stats->heatmap[block * HEATMAP_LBA_BUCKETS / info->block_count]
+                       [error_status ? HEATMAP_ERROR_COLUMN : heatmap_latency_column(elapsed)]++;
+    if (ctx->coverage) coverage_mark(ctx->coverage, block);
+
+    if (error_status && opts->fine_block_size == 0) {
+        elapsed = LATENCY_ERROR_US;
+        if (ctx->latency_map) ctx->latency_map[block] = LATENCY_MAP_ERROR;
+        if (ctx->logger) {
+            log_block(ctx->logger, block * info->sectors_per_block + info->sector_offset,
+                      info->sectors_per_block, elapsed, log_status_code(error_status), error);
+        }
+    } else {
+        if (!error_status) {
+            histogram_record(&ctx->stats->histogram, elapsed);
+            int zone = (int)(block * ETA_ZONES / info->block_count);
+            __atomic_fetch_add(&ctx->stats->zone_blocks[zone], 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&ctx->stats->zone_latency_us[zone], elapsed, __ATOMIC_RELAXED);
+            // 可疑块重测完成后会用最终延迟覆盖
+            if (ctx->latency_map) ctx->latency_map[block] = latency_map_encode(elapsed);
+        }
+
+        // 检查是否为可疑块（分层扫描时读取失败的大块同样需要细分定位）
+        if (error_status || elapsed > opts->suspect_threshold) {
+            __atomic_fetch_add(&categories[cat_count - 2].count, 1, __ATOMIC_RELAXED); // 可疑分类计数
+
+            if (ctx->retest_queue) {
+                // 交给后台线程重测，最终分类与日志在重测完成后写入
+                retest_queue_push(ctx->retest_queue, block, error_status);
+                if (error_status) elapsed = LATENCY_ERROR_US;
+            } else {
+                elapsed = resolve_suspect_block(ctx, block, error_status);
+            }
+        } else {
+            int status_index = find_category(categories, cat_count, elapsed);
+            __atomic_fetch_add(&categories[status_index].count, 1, __ATOMIC_RELAXED);
+
+            // 记录速度不好的区块
+            if (ctx->logger && elapsed > opts->log_threshold) {
+                log_block(ctx->logger, block * info->sectors_per_block + info->sector_offset,
+                          info->sectors_per_block, elapsed, status_index, 0);
+            }
+        }
+    }
+
+    // 慢块或读取错误附近安排更密的采样
+    if (ctx->iterator && elapsed > opts->suspect_threshold) {
+        unsigned long samples;
+        int regions = sample_iterator_refine(ctx->iterator, block - ctx->iterator_base, &samples);
+        ctx->stats->refine_regions += regions;
+        ctx->stats->refine_samples += samples;
+        __atomic_fetch_add(&ctx->total_samples, samples, __ATOMIC_RELAXED);
+    }
+
+    return elapsed;
+}
+
+// 时间预算：每个迭代器按自己实测的采样速度调整剩余样本数，使扫描在预算内结束。
+// 样本数只会在计划值以内调整，剩余样本仍均匀分布在尚未扫描的范围内
+typedef struct {
+    struct timespec     start;          // 本次运行开始计速的时间
+    struct timespec     last_check;
+    unsigned long       start_index;    // 开始计速时迭代器已取出的样本数
+    unsigned long       last_index;     // 上次检查时迭代器已取出的样本数
+    double              rate;           // 采样速度的指数滑动平均（样本/微秒），0 表示尚未预热
+} TimeBudget;
+
+void time_budget_init(TimeBudget *budget, const SampleIterator *iter) {
+    clock_gettime(CLOCK_MONOTONIC, &budget->start);
+    budget->last_check = budget->start;
+    budget->start_index = iter->current_index;
+    budget->last_index = iter->current_index;
+    budget->rate = 0;
+}
+
+// 在块与块之间调用，样本数有变化时返回 1
+int time_budget_update(TimeBudget *budget, const ScanContext *ctx, SampleIterator *iter) {
+    long budget_us = ctx->opts->time_budget * US_PER_SEC;
+    if (budget_us <= 0) return 0;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long interval_us = timespec_diff_us(&budget->last_check, &now);
+    if (interval_us < TIME_BUDGET_CHECK_US) return 0;
+
+    // 预热期间按累计平均计速，之后跟踪最近的速度变化（如机械硬盘外圈快内圈慢）
+    long measured_us = timespec_diff_us(&budget->start, &now);
+    if (budget->rate == 0) {
+        if (measured_us >= TIME_BUDGET_WARMUP_US) {
+            budget->rate = (double)(iter->current_index - budget->start_index) / measured_us;
+        }
+    } else {
+        double recent = (double)(iter->current_index - budget->last_index) / interval_us;
+        budget->rate += TIME_BUDGET_EWMA_ALPHA * (recent - budget->rate);
+    }
+    budget->last_check = now;
+    budget->last_index = iter->current_index;
+
+    // ctx->start_time 在续扫时已提前，预算按整个扫描计算
+    long remaining_us = budget_us - timespec_diff_us(&ctx->start_time, &now);
+    unsigned long target;
+    if (remaining_us <= 0) {
+        // 预算用完：放弃尚未扫描的加密区域，停止取样
+        int dropped = iter->refine_remaining > 0;
+        sample_iterator_drop_refine(iter);
+        if (iter->total_samples == iter->current_index) return dropped;
+        target = iter->current_index;
+    } else {
+        if (budget->rate == 0) return 0;
+
+        double more = budget->rate * remaining_us * TIME_BUDGET_MARGIN;
+        if (more >= iter->planned_samples - iter->current_index) {
+            target = iter->planned_samples;
+        } else {
+            target = iter->current_index + (unsigned long)more;
+        }
+        // 变化不大时不调整，避免均匀采样的步长反复抖动
+        unsigned long delta = target > iter->total_samples ? target - iter->total_samples
+                                                           : iter->total_samples - target;
+        if (delta <= iter->total_samples / 100 && target != iter->planned_samples) return 0;
+    }
+
+    if (target == iter->total_samples) return 0;
+    sample_iterator_retarget(iter, target);
+    return 1;
+}
+
+// 同步读取引擎：逐块 lseek + read，队列深度恒为 1
+// 同步读取引擎，返回 0 表示完成，1 表示被中断（断点已保存）
+int scan_engine_sync(ScanContext *ctx, SampleIterator *iterator, void *buffer) {
+    const ScanOptions *opts = ctx->opts;
+    const DeviceInfo *info = ctx->info;
+    int fd = ctx->fd;
+    // 判断是否为顺序扫描 (100% 均匀采样)
+    int is_sequential = (opts->sample_ratio >= 100.0 && !opts->random_sampling &&
+                         !opts->low_discrepancy && !ctx->coverage);
+
+    struct timespec block_start, block_end;
+    long last_elapsed = 0;  // 用于计算等待时间
+    long prev_block = -1;
+    TimeBudget budget;
+    time_budget_init(&budget, iterator);
+
+    long current_block;
+    while (1) {
+        // 块与块之间计数与迭代器状态一致，可以直接写断点
+        if (checkpoint_due(ctx)) {
+            CheckpointIterator state = { .block_base = 0, .iterator = *iterator };
+            checkpoint_write(ctx, &state, 1, NULL, 0);
+            if (scan_interrupted) return 1;
+        }
+        if (time_budget_update(&budget, ctx, iterator)) {
+            __atomic_store_n(&ctx->total_samples, ctx->processed + sample_iterator_remaining(iterator),
+                             __ATOMIC_RELAXED);
+        }
+
+        if ((current_block = get_next_sample_block(iterator)) == -1) break;
+        unsigned long block = (unsigned long)current_block;
+
+        // 等待时间处理
+        if (opts->wait_factor > 0 && last_elapsed > 0) {
+            long wait_time_us = (last_elapsed * opts->wait_factor) / 100;
+            if (wait_time_us > 0) {
+                struct timespec wait_time = {
+                    .tv_sec = wait_time_us / US_PER_SEC,
+                    .tv_nsec = (wait_time_us % US_PER_SEC) * 1000
+                };
+                nanosleep(&wait_time, NULL);
+            }
+        }
+
+        // 优化：顺序扫描且连续块时不需要lseek
+        if (!is_sequential || prev_block == -1 || block != (unsigned long)(prev_block + 1)) {
+            // 需要定位
+            off_t block_offset = (off_t)(block * info->sectors_per_block + info->sector_offset) * info->sector_size;
+            if (lseek(fd, block_offset, SEEK_SET) != block_offset) {
+                prev_block = -1;
+                last_elapsed = record_block_result(ctx, block, 0, "定位错误");
+                continue;
+            }
+        }
+
+        prev_block = (long)block;
+
+        clock_gettime(CLOCK_MONOTONIC, &block_start);
+        ssize_t bytes_read = read(fd, buffer, opts->block_size);
+        clock_gettime(CLOCK_MONOTONIC, &block_end);
+
+        if (bytes_read != (ssize_t)opts->block_size) {
+            if (bytes_read >= 0) errno = 0;     // 读取不完整
+            last_elapsed = record_block_result(ctx, block, 0, "读取错误");
+        } else {
+            long elapsed = timespec_diff_us(&block_start, &block_end);
+            last_elapsed = record_block_result(ctx, block, elapsed, NULL);
+        }
+
+        // 可疑块重测会移动文件位置，下一块需要重新定位
+        if (last_elapsed > opts->suspect_threshold) {
+            prev_block = -1;
+        }
+    }
+
+    return 0;
+}
+
+// 最小化的 io_uring 封装（直接使用系统调用，不依赖 liburing）
+typedef struct {
+    int                     ring_fd;
+    unsigned                entries;
+    unsigned               *sq_head;
+    unsigned               *sq_tail;
+    unsigned               *sq_mask;
+    unsigned               *sq_array;
+    unsigned               *cq_head;
+    unsigned               *cq_tail;
+    unsigned               *cq_mask;
+    struct io_uring_sqe    *sqes;
+    struct io_uring_cqe    *cqes;
+    void                   *sq_ptr;
+    void                   *cq_ptr;
+    size_t                  sq_size;
+    size_t                  cq_size;
+    size_t                  sqes_size;
+} UringQueue;
+
+void uring_queue_exit(UringQueue *q) {
+    if (q->sqes && q->sqes != MAP_FAILED) munmap(q->sqes, q->sqes_size);
+    if (q->cq_ptr && q->cq_ptr != MAP_FAILED && q->cq_ptr != q->sq_ptr) munmap(q->cq_ptr, q->cq_size);
+    if (q->sq_ptr && q->sq_ptr != MAP_FAILED) munmap(q->sq_ptr, q->sq_size);
+    if (q->ring_fd >= 0) close(q->ring_fd);
+    q->ring_fd = -1;
+}
+
+// 初始化 io_uring，成功返回 0，失败返回 -1 并保留 errno
+int uring_queue_init(UringQueue *q, unsigned entries) {
+    struct io_uring_params params;
+    memset(q, 0, sizeof(*q));
+    memset(&params, 0, sizeof(params));
+
+    q->ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (q->ring_fd < 0) {
+        q->ring_fd = -1;
+        return -1;
+    }
+    q->entries = params.sq_entries;
+
+    q->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    q->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (q->cq_size > q->sq_size) q->sq_size = q->cq_size;
+        q->cq_size = q->sq_size;
+    }
+
+    q->sq_ptr = mmap(NULL, q->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     q->ring_fd, IORING_OFF_SQ_RING);
+    if (q->sq_ptr == MAP_FAILED) goto fail;
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        q->cq_ptr = q->sq_ptr;
+    } else {
+        q->cq_ptr = mmap(NULL, q->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         q->ring_fd, IORING_OFF_CQ_RING);
+        if (q->cq_ptr == MAP_FAILED) goto fail;
+    }
+
+    q->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    q->sqes = mmap(NULL, q->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   q->ring_fd, IORING_OFF_SQES);
+    if (q->sqes == MAP_FAILED) goto fail;
+
+    char *sq = q->sq_ptr;
+    char *cq = q->cq_ptr;
+    q->sq_head  = (unsigned *)(sq + params.sq_off.head);
+    q->sq_tail  = (unsigned *)(sq + params.sq_off.tail);
+    q->sq_mask  = (unsigned *)(sq + params.sq_off.ring_mask);
+    q->sq_array = (unsigned *)(sq + params.sq_off.array);
+    q->cq_head  = (unsigned *)(cq + params.cq_off.head);
+    q->cq_tail  = (unsigned *)(cq + params.cq_off.tail);
+    q->cq_mask  = (unsigned *)(cq + params.cq_off.ring_mask);
+    q->cqes     = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    return 0;
+
+fail:
+    {
+        int saved_errno = errno;
+        uring_queue_exit(q);
+        errno = saved_errno;
+    }
+    return -1;
+}
+
+// 向提交队列追加一个定位读请求（调用方保证队列未满）
+void uring_prep_readv(UringQueue *q, int fd, struct iovec *iov, off_t offset, unsigned long user_data) {
+    unsigned tail = *q->sq_tail;
+    unsigned index = tail & *q->sq_mask;
+    struct io_uring_sqe *sqe = &q->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long)iov;
+    sqe->len = 1;
+    sqe->off = offset;
+    sqe->user_data = user_data;
+
+    q->sq_array[index] = index;
+    __atomic_store_n(q->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+// 提交请求并等待至少 wait_nr 个完成事件，返回已提交数量
+int uring_submit_and_wait(UringQueue *q, unsigned to_submit, unsigned wait_nr) {
+    unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+    int ret;
+    do {
+        ret = syscall(__NR_io_uring_enter, q->ring_fd, to_submit, wait_nr, flags, NULL, 0);
+    } while (ret < 0 && errno == EINTR);
+    return ret;
+}
+
+// io_uring 引擎中每个在途请求的状态
+typedef struct {
+    unsigned long   block;
+    struct iovec    iov;
+    struct timespec submit_time;
+    int             res;            // 推迟处理的可疑块：读取结果和耗时
+    long            elapsed;
+} UringSlot;
+
+// io_uring 读取引擎：保持最多 queue_depth 个读请求在途，
+// 每个请求从提交到完成单独计时，结果走与同步引擎相同的记录路径。
+// 同步重测时可疑块推迟到没有在途请求后再处理，以免重测耗时算进其他请求的延迟
+// 返回 0 表示完成，1 表示被中断（断点已保存），-1 表示 io_uring 不可用（调用方应回退到同步引擎），
+// -2 表示扫描中途提交失败（在途请求已全部收割）
+int scan_engine_uring(ScanContext *ctx, SampleIterator *iterator, const char *device) {
+    const ScanOptions *opts = ctx->opts;
+    const DeviceInfo *info = ctx->info;
+    unsigned depth = (unsigned)opts->queue_depth;
+
+    UringQueue ring;
+    if (uring_queue_init(&ring, depth) != 0) {
+        fprintf(stderr, "警告: io_uring 初始化失败 (%s)，回退到同步读取\n", strerror(errno));
+        return -1;
+    }
+    if (depth > ring.entries) depth = ring.entries;
+
+    // io_uring 请求使用独立的句柄，不影响重测使用的文件位置
+    int fd = open(device, O_RDONLY | O_DIRECT);
+    if (fd == -1) {
+        fprintf(stderr, "警告: 无法打开设备用于 io_uring (%s)，回退到同步读取\n", strerror(errno));
+        uring_queue_exit(&ring);
+        return -1;
+    }
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    size_t align_size = (info->sector_size > page_size) ? info->sector_size : page_size;
+    void *buffers = NULL;
+    UringSlot *slots = calloc(depth, sizeof(UringSlot));
+    unsigned *free_slots = malloc(depth * sizeof(unsigned));
+    unsigned *queued = malloc(depth * sizeof(unsigned));      // 已准备未提交的请求，按提交顺序
+    unsigned *deferred = malloc(depth * sizeof(unsigned));    // 等待同步重测的可疑块
+    unsigned long *batch = malloc(depth * sizeof(unsigned long));
+    if (!slots || !free_slots || !queued || !deferred || !batch ||
+        posix_memalign(&buffers, align_size, depth * opts->block_size)) {
+        perror("内存分配失败");
+        free(slots);
+        free(free_slots);
+        free(queued);
+        free(deferred);
+        free(batch);
+        close(fd);
+        uring_queue_exit(&ring);
+        return -1;
+    }
+
+    for (unsigned i = 0; i < depth; i++) {
+        slots[i].iov.iov_base = (char *)buffers + (size_t)i * opts->block_size;
+        slots[i].iov.iov_len = opts->block_size;
+        free_slots[i] = depth - 1 - i;
+    }
+    unsigned free_count = depth;
+    unsigned inflight = 0;
+    unsigned unsubmitted = 0;
+    unsigned deferred_count = 0;
+    int draining = 0;       // 写断点前不再提交新请求，等待在途请求完成
+    int failed = 0;         // 提交失败后不再提交，收割完在途请求即退出
+    int interrupted = 0;
+    TimeBudget budget;
+    time_budget_init(&budget, iterator);
+
+    while (1) {
+        // 在途请求全部完成后再重测推迟的可疑块，此时重测不会影响任何请求的计时
+        if (deferred_count > 0 && inflight == 0) {
+            for (unsigned i = 0; i < deferred_count; i++) {
+                UringSlot *slot = &slots[deferred[i]];
+                if (slot->res != (int)opts->block_size) {
+                    errno = slot->res < 0 ? -slot->res : 0;
+                    record_block_result(ctx, slot->block, 0, "读取错误");
+                } else {
+                    record_block_result(ctx, slot->block, slot->elapsed, NULL);
+                }
+                free_slots[free_count++] = deferred[i];
+            }
+            deferred_count = 0;
+        }
+
+        if (failed && inflight == 0) break;
+        if (!draining && checkpoint_due(ctx)) draining = 1;
+        if (time_budget_update(&budget, ctx, iterator)) {
+            __atomic_store_n(&ctx->total_samples, ctx->processed + inflight + unsubmitted + deferred_count +
+                             sample_iterator_remaining(iterator), __ATOMIC_RELAXED);
+        }
+
+        // 补满队列（有推迟的可疑块时不再补充，让在途请求尽快完成）
+        int holding = failed || deferred_count > 0;
+        size_t batch_count = draining || holding ? 0 : sample_iterator_next_batch(iterator, batch, free_count);
+        for (size_t i = 0; i < batch_count; i++) {
+            unsigned id = free_slots[--free_count];
+            UringSlot *slot = &slots[id];
+            slot->block = batch[i];
+            off_t block_offset = (off_t)(slot->block * info->sectors_per_block + info->sector_offset) * info->sector_size;
+            uring_prep_readv(&ring, fd, &slot->iov, block_offset, id);
+            queued[unsubmitted++] = id;
+        }
+
+        if (inflight + unsubmitted == 0) {
+            if (!draining) break;
+
+            // 在途请求已全部完成，迭代器状态与计数一致
+            CheckpointIterator state = { .block_base = 0, .iterator = *iterator };
+            checkpoint_write(ctx, &state, 1, NULL, 0);
+            if (scan_interrupted) {
+                interrupted = 1;
+                break;
+            }
+            draining = 0;
+            continue;
+        }
+
+        struct timespec submit_time;
+        clock_gettime(CLOCK_MONOTONIC, &submit_time);
+        int submitted = uring_submit_and_wait(&ring, holding ? 0 : unsubmitted, 1);
+        if (submitted < 0) {
+            if (failed) {
+                // 无法等待在途请求完成，内核可能仍在写入缓冲区，只能不释放
+                perror("等待 io_uring 在途请求失败");
+                buffers = NULL;
+                slots = NULL;
+                break;
+            }
+            perror("io_uring 提交失败");
+            failed = 1;
+            continue;
+        }
+        // 提交队列按顺序消费，只有真正提交的请求从这一刻开始计时，其余留到下一轮
+        for (int i = 0; i < submitted; i++) {
+            slots[queued[i]].submit_time = submit_time;
+        }
+        unsubmitted -= submitted;
+        memmove(queued, queued + submitted, unsubmitted * sizeof(unsigned));
+        inflight += submitted;
+
+        // 完成时间在返回后立即取一次，整批共用：记录结果时可能同步重测或二分定位，
+        // 逐个取时间会把这些耗时算进后面请求的延迟。之后才完成的请求留到下一轮
+        struct timespec complete_time;
+        clock_gettime(CLOCK_MONOTONIC, &complete_time);
+        unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+
+        // 收割本批已完成的请求
+        unsigned head = *ring.cq_head;
+        while (head != tail) {
+            struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+            unsigned id = (unsigned)cqe->user_data;
+            int res = cqe->res;
+            head++;
+            __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+
+            UringSlot *slot = &slots[id];
+            inflight--;
+
+            // 需要同步重测的可疑块（超过阈值，或分层扫描时读取失败）先保留结果
+            slot->res = res;
+            slot->elapsed = timespec_diff_us(&slot->submit_time, &complete_time);
+            int suspect = res != (int)opts->block_size ? opts->fine_block_size > 0
+                                                       : slot->elapsed > opts->suspect_threshold;
+            if (suspect && !ctx->retest_queue) {
+                deferred[deferred_count++] = id;
+                continue;
+            }
+
+            if (res != (int)opts->block_size) {
+                errno = res < 0 ? -res : 0;
+                record_block_result(ctx, slot->block, 0, "读取错误");
+            } else {
+                record_block_result(ctx, slot->block, slot->elapsed, NULL);
+            }
+            free_slots[free_count++] = id;
+        }
+    }
+
+    free(buffers);
+    free(slots);
+    free(free_slots);
+    free(queued);
+    free(deferred);
+    free(batch);
+    close(fd);
+    uring_queue_exit(&ring);
+    return failed ? -2 : interrupted;
+}
+
+// 多线程引擎的暂停控制：写断点前让所有工作线程停在块与块之间
+typedef struct {
+    pthread_mutex_t     lock;
+    pthread_cond_t      changed;
+    int                 requested;      // 1=请求暂停，工作线程在每块之前检查
+    int                 stop;           // 1=恢复后直接退出（扫描被中断）
+    int                 paused;         // 已暂停的线程数
+    int                 finished;       // 已结束的线程数
+} ScanPause;
+
+// 多线程引擎中每个工作线程的私有状态，热路径上不共享任何可写数据
+typedef struct {
+    ScanContext         ctx;
+    ScanPause          *pause;
+    SampleIterator      iterator;
+    unsigned long       block_base;     // 本线程负责范围的起始块号
+    TimeCategory        categories[MAX_CATEGORIES];
+    ScanStats           stats;
+    void               *buffer;
+    pthread_t           thread;
+    int                 finished;
+} ScanWorker;
+
+// 工作线程：在自己的块范围内按采样顺序 pread，结果记入线程私有的统计
+void *scan_worker_thread(void *arg) {
+    ScanWorker *worker = arg;
+    ScanContext *ctx = &worker->ctx;
+    const ScanOptions *opts = ctx->opts;
+    const DeviceInfo *info = ctx->info;
+    struct timespec block_start, block_end;
+    TimeBudget budget;
+    time_budget_init(&budget, &worker->iterator);
+
+    long current_block;
+    while (1) {
+        if (__atomic_load_n(&worker->pause->requested, __ATOMIC_ACQUIRE)) {
+            ScanPause *pause = worker->pause;
+            pthread_mutex_lock(&pause->lock);
+            pause->paused++;
+            pthread_cond_broadcast(&pause->changed);
+            while (pause->requested) {
+                pthread_cond_wait(&pause->changed, &pause->lock);
+            }
+            pause->paused--;
+            int stop = pause->stop;
+            pthread_mutex_unlock(&pause->lock);
+            if (stop) break;
+        }
+
+        if (time_budget_update(&budget, ctx, &worker->iterator)) {
+            __atomic_store_n(&ctx->total_samples, ctx->processed + sample_iterator_remaining(&worker->iterator),
+                             __ATOMIC_RELAXED);
+        }
+        if ((current_block = get_next_sample_block(&worker->iterator)) == -1) break;
+        unsigned long block = worker->block_base + (unsigned long)current_block;
+        off_t block_offset = (off_t)(block * info->sectors_per_block + info->sector_offset) * info->sector_size;
+
+        clock_gettime(CLOCK_MONOTONIC, &block_start);
+        ssize_t bytes_read = pread(ctx->fd, worker->buffer, opts->block_size, block_offset);
+        clock_gettime(CLOCK_MONOTONIC, &block_end);
+
+        if (bytes_read != (ssize_t)opts->block_size) {
+            if (bytes_read >= 0) errno = 0;
+            record_block_result(ctx, block, 0, "读取错误");
+        } else {
+            record_block_result(ctx, block, timespec_diff_us(&block_start, &block_end), NULL);
+        }
+    }
+
+    pthread_mutex_lock(&worker->pause->lock);
+    worker->pause->finished++;
+    pthread_cond_broadcast(&worker->pause->changed);
+    pthread_mutex_unlock(&worker->pause->lock);
+
+    __atomic_store_n(&worker->finished, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// 释放工作线程资源
+void free_scan_workers(ScanWorker *workers, int count) {
+    for (int i = 0; i < count; i++) {
+        if (workers[i].buffer) free(workers[i].buffer);
+        if (workers[i].ctx.fd >= 0) close(workers[i].ctx.fd);
+    }
+    free(workers);
+}
+
+// 多线程 pread 引擎：把块范围切分给各线程，每个线程使用独立的 O_DIRECT 句柄和缓冲区，
+// 分类计数与直方图在扫描结束后合并。各线程的计数注册到进度线程汇总显示，主线程只负责写断点。
+// resume 非 NULL 时按断点中各线程的范围和迭代器状态继续（线程数取自断点）。
+// 返回 0 表示完成，1 表示被中断（断点已保存），-1 表示初始化失败（调用方应回退到同步引擎）
+int scan_engine_threads(ScanContext *ctx, const char *device, int thread_count,
+                        const CheckpointIterator *resume) {
+    const ScanOptions *opts = ctx->opts;
+    const DeviceInfo *info = ctx->info;
+
+    if (!resume) {
+        if ((unsigned long)thread_count > info->block_count) thread_count = (int)info->block_count;
+        if (thread_count < 1) thread_count = 1;
+    }
+
+    ScanWorker *workers = calloc(thread_count, sizeof(ScanWorker));
+    if (!workers) {
+        perror("内存分配失败");
+        return -1;
+    }
+    for (int i = 0; i < thread_count; i++) {
+        workers[i].ctx.fd = -1;
+    }
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    size_t align_size = (info->sector_size > page_size) ? info->sector_size : page_size;
+
+    ScanPause pause = { .requested = 0 };
+    pthread_mutex_init(&pause.lock, NULL);
+    pthread_cond_init(&pause.changed, NULL);
+
+    for (int i = 0; i < thread_count; i++) {
+        ScanWorker *worker = &workers[i];
+        unsigned long range_start = info->block_count * i / thread_count;
+        unsigned long range_end = info->block_count * (i + 1) / thread_count;
+
+        worker->ctx = *ctx;
+        worker->ctx.categories = worker->categories;
+        worker->ctx.stats = &worker->stats;
+        worker->ctx.processed = 0;
+        memcpy(worker->categories, ctx->categories, sizeof(TimeCategory) * ctx->cat_count);
+        for (int j = 0; j < ctx->cat_count; j++) {
+            worker->categories[j].count = 0;
+        }
+        scan_stats_init(&worker->stats);
+
+        worker->ctx.fd = open(device, O_RDONLY | O_DIRECT);
+        if (worker->ctx.fd == -1 ||
+            posix_memalign(&worker->buffer, align_size, opts->block_size)) {
+            fprintf(stderr, "警告: 工作线程初始化失败 (%s)，回退到同步读取\n", strerror(errno));
+            worker->buffer = NULL;
+            free_scan_workers(workers, thread_count);
+            pthread_mutex_destroy(&pause.lock);
+            pthread_cond_destroy(&pause.changed);
+            return -1;
+        }
+        worker->ctx.retest_buffer = worker->buffer;
+        worker->ctx.iterator = &worker->iterator;
+        worker->pause = &pause;
+
+        if (resume) {
+            worker->block_base = resume[i].block_base;
+            worker->ctx.iterator_base = worker->block_base;
+            worker->iterator = resume[i].iterator;
+            if (worker->iterator.coverage) worker->iterator.coverage = ctx->coverage;
+        } else {
+            worker->block_base = range_start;
+            worker->ctx.iterator_base = range_start;
+            init_scan_iterator(&worker->iterator, opts, range_end - range_start,
+                               ctx->coverage, range_start, i);
+        }
+        worker->ctx.total_samples = sample_iterator_remaining(&worker->iterator);
+    }
+
+    // 主上下文只保留之前各次运行的计数，本次的样本数由各线程自己维护
+    __atomic_store_n(&ctx->total_samples, ctx->processed, __ATOMIC_RELAXED);
+    int source_base = progress_add_source(ctx->progress, &workers[0].ctx);
+    for (int i = 1; i < thread_count; i++) {
+        progress_add_source(ctx->progress, &workers[i].ctx);
+    }
+
+    int started = 0;
+    for (; started < thread_count; started++) {
+        if (pthread_create(&workers[started].thread, NULL, scan_worker_thread, &workers[started]) != 0) {
+            fprintf(stderr, "警告: 无法创建工作线程，仅使用 %d 个线程\n", started);
+            // 未启动线程的范围由主线程同步完成
+            for (int i = started; i < thread_count; i++) {
+                scan_worker_thread(&workers[i]);
+            }
+            break;
+        }
+    }
+
+    int running = 1;
+    int interrupted = 0;
+    while (running) {
+        struct timespec interval = { .tv_sec = 0, .tv_nsec = 50000000 };
+        nanosleep(&interval, NULL);
+
+        running = 0;
+        for (int i = 0; i < thread_count; i++) {
+            if (!__atomic_load_n(&workers[i].finished, __ATOMIC_ACQUIRE)) running = 1;
+        }
+
+        if (running && checkpoint_due(ctx)) {
+            // 让所有工作线程停在块与块之间，再保存各自的迭代器状态和计数
+            pthread_mutex_lock(&pause.lock);
+            __atomic_store_n(&pause.requested, 1, __ATOMIC_RELEASE);
+            while (pause.paused + pause.finished < thread_count) {
+                pthread_cond_wait(&pause.changed, &pause.lock);
+            }
+            pthread_mutex_unlock(&pause.lock);
+
+            CheckpointIterator states[MAX_THREADS];
+            ScanContext *parts[MAX_THREADS];
+            for (int i = 0; i < thread_count; i++) {
+                states[i].block_base = workers[i].block_base;
+                states[i].iterator = workers[i].iterator;
+                parts[i] = &workers[i].ctx;
+            }
+            checkpoint_write(ctx, states, thread_count, parts, thread_count);
+
+            pthread_mutex_lock(&pause.lock);
+            pause.stop = interrupted = scan_interrupted;
+            __atomic_store_n(&pause.requested, 0, __ATOMIC_RELEASE);
+            pthread_cond_broadcast(&pause.changed);
+            pthread_mutex_unlock(&pause.lock);
+            if (interrupted) break;
+        }
+    }
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    // 合并各线程的统计结果，同时注销进度数据源，进度线程不会看到重复计算的计数
+    pthread_mutex_lock(&ctx->progress->lock);
+    for (int i = 0; i < thread_count; i++) {
+        ctx->processed += workers[i].ctx.processed;
+        ctx->total_samples += workers[i].ctx.total_samples;
+        for (int j = 0; j < ctx->cat_count; j++) {
+            ctx->categories[j].count += workers[i].categories[j].count;
+        }
+        scan_stats_merge(ctx->stats, &workers[i].stats);
+    }
+    ctx->progress->source_count = source_base;
+    pthread_mutex_unlock(&ctx->progress->lock);
+
+    free_scan_workers(workers, thread_count);
+    pthread_mutex_destroy(&pause.lock);
+    pthread_cond_destroy(&pause.changed);
+    return interrupted;
+}
+
+// 执行主要的扫描过程。checkpoint 非 NULL 时定期写断点，其中已载入断点内容时从断点继续。
+// 返回 0 表示完成，1 表示被中断（断点已保存），-1 表示读取引擎出错、扫描未完成
+int perform_scan(int fd, void *buffer, const ScanOptions *opts, const DeviceInfo *info,
+                 TimeCategory *categories, int cat_count, ScanStats *stats,
+                 ScanLogger *logger, unsigned char *latency_map, unsigned char *coverage,
+                 ScanCheckpoint *checkpoint) {
+    const CheckpointHeader *resume = (checkpoint && checkpoint->iterators) ? &checkpoint->header : NULL;
+
+    // 初始化采样迭代器
+    SampleIterator iterator;
+    init_scan_iterator(&iterator, opts, info->block_count, coverage, 0, 0);
+
+    printf("\033[1;37m【采样策略】\033[m计划扫描块数: %lu (共 %lu 块)\n", iterator.total_samples, info->block_count);
+    // 判断是否为顺序扫描 (100% 均匀采样)
+    int is_sequential = (opts->sample_ratio >= 100.0 && !opts->random_sampling &&
+                         !opts->low_discrepancy && !coverage);
+    printf("\033[1;37m【采样策略】\033[m扫描策略: \033[32m%s\033[m\n", is_sequential ? "顺序全量扫描" : "跳跃式前进扫描");
+    if (!is_sequential) {
+        printf("\033[1;37m【采样策略】\033[m抽样比例: %.1f%%\n", opts->sample_ratio);
+        printf("\033[1;37m【采样策略】\033[m采样模式: \033[32m%s\033[m\n", opts->random_sampling ? "随机采样" : "均匀采样");
+        if (iterator.low_discrepancy) {
+            printf("\033[1;37m【采样策略】\033[m采样顺序: \033[32m低差异序列\033[m (每 %lu 块一个排序窗口)\n",
+                   1UL << iterator.ldc_window_bits);
+        }
+    }
+    if (iterator.refine) {
+        printf("\033[1;37m【采样策略】\033[m自适应加密: 慢块附近逐级加密采样，直至逐块扫描\n");
+    }
+    if (opts->time_budget > 0) {
+        printf("\033[1;37m【采样策略】\033[m时间预算: %ld 秒，按实测速度调整抽样比例（不超过 %.1f%%）\n",
+               opts->time_budget, opts->sample_ratio);
+    }
+    if (opts->wait_factor > 0) {
+        printf("\033[1;37m【采样策略】\033[m等待时间因子: %d%%\n", opts->wait_factor);
+        if (opts->engine != ENGINE_SYNC) {
+            printf("\033[1;37m【采样策略】\033[m注意: 等待时间因子仅对同步读取引擎生效\n");
+        }
+    }
+    char latency[32];
+    if (opts->engine == ENGINE_THREADS) {
+        printf("\033[1;37m【采样策略】\033[m多线程引擎: %d 个线程，按块范围分段扫描\n", opts->threads);
+    }
+    printf("\033[1;37m【采样策略】\033[m可疑块阈值: %s (重测 %d 次，间隔 %d ms)\n",
+           format_latency(opts->suspect_threshold, latency, sizeof(latency)),
+           opts->suspect_retries, opts->suspect_interval);
+
+    ScanContext ctx = {
+        .opts           = opts,
+        .info           = info,
+        .categories     = categories,
+        .cat_count      = cat_count,
+        .logger         = logger,
+        .stats          = stats,
+        .fd             = fd,
+        .retest_buffer  = buffer,
+        .latency_map    = latency_map,
+        .coverage       = coverage,
+        .checkpoint     = checkpoint,
+        .iterator       = &iterator,
+        .iterator_base  = 0,
+        .processed      = 0,
+        .total_samples  = iterator.total_samples,
+    };
+
+    clock_gettime(CLOCK_MONOTONIC, &ctx.start_time);
+    if (checkpoint) checkpoint->last_save = ctx.start_time;
+    if (resume) {
+        ctx.processed = resume->processed;
+        timespec_sub_us(&ctx.start_time, resume->elapsed_us);
+        if (resume->iterator_count == 1) {
+            iterator = checkpoint->iterators[0].iterator;
+            if (iterator.coverage) iterator.coverage = coverage;
+            ctx.total_samples = ctx.processed + sample_iterator_remaining(&iterator);
+        }
+    }
+
+    printf("========================================\n");
+
+    ProgressRenderer progress;
+    progress_renderer_start(&progress, &ctx);
+    ctx.progress = &progress;
+
+    // 启动异步重测队列
+    RetestQueue *retest_queue = NULL;
+    if (opts->async_retest) {
+        retest_queue = malloc(sizeof(RetestQueue));
+        if (retest_queue && retest_queue_start(retest_queue, &ctx, opts->device) == 0) {
+            ctx.retest_queue = retest_queue;
+            progress_add_source(&progress, &retest_queue->ctx);
+        } else {
+            free(retest_queue);
+            retest_queue = NULL;
+        }
+    }
+
+    // 断点中尚未重测的可疑块（已计入可疑分类）
+    if (resume) {
+        for (uint32_t i = 0; i < resume->pending_count; i++) {
+            const CheckpointSuspect *suspect = &checkpoint->pending[i];
+            const char *status = checkpoint_status_name(suspect->status);
+            if (ctx.retest_queue) {
+                retest_queue_push(ctx.retest_queue, suspect->block, status);
+            } else {
+                resolve_suspect_block(&ctx, suspect->block, status);
+            }
+        }
+    }
+
+    int result = -1;
+    if (resume && resume->iterator_count > 1) {
+        result = scan_engine_threads(&ctx, opts->device, resume->iterator_count, checkpoint->iterators);
+        if (result < 0) {
+            fprintf(stderr, "错误: 无法恢复多线程扫描，断点文件保持不变\n");
+            result = 1;
+        }
+    } else {
+        if (opts->engine == ENGINE_URING) {
+            result = scan_engine_uring(&ctx, &iterator, opts->device);
+        } else if (opts->engine == ENGINE_THREADS) {
+            result = scan_engine_threads(&ctx, opts->device, opts->threads, NULL);
+        }
+        if (result == -2) {
+            fprintf(stderr, "错误: io_uring 读取中途失败，扫描未完成\n");
+            result = -1;
+        } else if (result < 0) {
+            result = scan_engine_sync(&ctx, &iterator, buffer);
+        }
+    }
+
+    // 之后的等待和收尾都在本线程进行，进度行由这里最后刷新一次
+    progress_renderer_stop(&progress);
+
+    if (retest_queue) {
+        if (result == 0 && checkpoint) {
+            iterator.current_index = iterator.total_samples;
+            result = retest_queue_drain(retest_queue, &ctx, &iterator);
+        }
+        retest_queue_finish(retest_queue, &ctx, result != 0);
+        progress.source_count = 1;      // 重测计数已合并到主上下文
+        free(retest_queue);
+    }
+
+    if (result == 0) progress_render(&progress, 1);
+    progress_renderer_destroy(&progress);
+    printf("\n\n");
+    return result;
+}
+
+// 热力图第 row 行的起始扇区（块号区间 [ceil(row·N/行数), ceil((row+1)·N/行数))）
+unsigned long heatmap_row_sector(const DeviceInfo *info, int row) {
+    unsigned long block = (row * info->block_count + HEATMAP_LBA_BUCKETS - 1) / HEATMAP_LBA_BUCKETS;
+    return info->start_sector + block * info->sectors_per_block;
+}
+
+// 在报告中以字符画显示热力图：纵向把 LBA 合并为 HEATMAP_ASCII_ROWS 行，横向只显示有数据的延迟列。
+// 每行按本行最大的格子归一化（对数刻度），便于比较不同位置的延迟分布
+void print_heatmap_ascii(FILE *out, const ScanStats *stats, const DeviceInfo *info) {
+    static const char shades[] = " .:-=+*#%@";
+    unsigned long rows[HEATMAP_ASCII_ROWS][HEATMAP_COLUMNS];
+    memset(rows, 0, sizeof(rows));
+
+    int first = HEATMAP_LATENCY_BUCKETS, last = -1, errors = 0;
+    for (int i = 0; i < HEATMAP_LBA_BUCKETS; i++) {
+        for (int j = 0; j < HEATMAP_COLUMNS; j++) {
+            if (stats->heatmap[i][j] == 0) continue;
+            rows[i * HEATMAP_ASCII_ROWS / HEATMAP_LBA_BUCKETS][j] += stats->heatmap[i][j];
+            if (j == HEATMAP_ERROR_COLUMN) {
+                errors = 1;
+            } else {
+                if (j < first) first = j;
+                if (j > last) last = j;
+            }
+        }
+    }
+    if (last < 0 && !errors) return;
+    if (last < 0) first = last = 0;
+
+    char low[32], high[32];
+    fprintf(out, "------------------------\n");
+    fprintf(out, "延迟热力图 (纵轴: 起始扇区; 横轴: 延迟 %s ~ %s，每列 ×2%s):\n",
+            format_latency(1L << first, low, sizeof(low)), format_latency(1L << (last + 1), high, sizeof(high)),
+            errors ? "，E 列为读取错误" : "");
+    for (int r = 0; r < HEATMAP_ASCII_ROWS; r++) {
+        unsigned long row_max = rows[r][HEATMAP_ERROR_COLUMN];
+        for (int j = first; j <= last; j++) {
+            if (rows[r][j] > row_max) row_max = rows[r][j];
+        }
+        fprintf(out, "%12lu |", heatmap_row_sector(info, r * HEATMAP_LBA_BUCKETS / HEATMAP_ASCII_ROWS));
+        for (int j = first; j <= last + errors; j++) {
+            int column = j <= last ? j : HEATMAP_ERROR_COLUMN;
+            if (column == HEATMAP_ERROR_COLUMN) fputs(" E", out);
+            int shade = 0;
+            if (rows[r][column] > 0) {
+                shade = 1 + (int)((sizeof(shades) - 3) * log1p(rows[r][column]) / log1p(row_max));
+            }
+            fputc(shades[shade], out);
+        }
+        fprintf(out, "|\n");
+    }
+}
+
+// 保存热力图，格式由扩展名决定：.json 矩阵、.pgm 灰度图（每行一个 LBA 区间，越亮块数越多），其他为 CSV
+int write_heatmap(const char *path, const ScanStats *stats, const DeviceInfo *info) {
+    const char *ext = strrchr(path, '.');
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "警告: 无法创建热力图 '%s': %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    if (ext && strcmp(ext, ".pgm") == 0) {
+        // 与字符画相同，每行按本行最大值以对数刻度归一化
+        fprintf(out, "P5\n%d %d\n255\n", HEATMAP_COLUMNS * HEATMAP_PGM_CELL_WIDTH, HEATMAP_LBA_BUCKETS);
+        unsigned char line[HEATMAP_COLUMNS * HEATMAP_PGM_CELL_WIDTH];
+        for (int i = 0; i < HEATMAP_LBA_BUCKETS; i++) {
+            uint32_t row_max = 0;
+            for (int j = 0; j < HEATMAP_COLUMNS; j++) {
+                if (stats->heatmap[i][j] > row_max) row_max = stats->heatmap[i][j];
+            }
+            for (int j = 0; j < HEATMAP_COLUMNS; j++) {
+                unsigned char value = row_max > 0 ?
+                    (unsigned char)lround(255 * log1p(stats->heatmap[i][j]) / log1p(row_max)) : 0;
+                memset(line + j * HEATMAP_PGM_CELL_WIDTH, value, HEATMAP_PGM_CELL_WIDTH);
+            }
+            fwrite(line, sizeof(line), 1, out);
+        }
+    } else if (ext && strcmp(ext, ".json") == 0) {
+        fprintf(out, "{\n  \"sector_size\": %d,\n  \"latency_columns_us\": [", info->sector_size);
+        for (int j = 0; j < HEATMAP_LATENCY_BUCKETS; j++) {
+            fprintf(out, "%s%ld", j > 0 ? ", " : "", 1L << j);
+        }
+        fprintf(out, "],\n  \"error_column\": %d,\n  \"rows\": [", HEATMAP_ERROR_COLUMN);
+        for (int i = 0; i < HEATMAP_LBA_BUCKETS; i++) {
+            fprintf(out, "%s\n    {\"start_sector\": %lu, \"end_sector\": %lu, \"counts\": [",
+                    i > 0 ? "," : "", heatmap_row_sector(info, i), heatmap_row_sector(info, i + 1));
+            for (int j = 0; j < HEATMAP_COLUMNS; j++) {
+                fprintf(out, "%s%u", j > 0 ? ", " : "", stats->heatmap[i][j]);
+            }
+            fprintf(out, "]}");
+        }
+        fprintf(out, "\n  ]\n}\n");
+    } else {
+        fprintf(out, "start_sector,end_sector");
+        for (int j = 0; j < HEATMAP_LATENCY_BUCKETS; j++) fprintf(out, ",%ldus", 1L << j);
+        fprintf(out, ",error\n");
+        for (int i = 0; i < HEATMAP_LBA_BUCKETS; i++) {
+            fprintf(out, "%lu,%lu", heatmap_row_sector(info, i), heatmap_row_sector(info, i + 1));
+            for (int j = 0; j < HEATMAP_COLUMNS; j++) fprintf(out, ",%u", stats->heatmap[i][j]);
+            fprintf(out, "\n");
+        }
+    }
+
+    if (fclose(out) != 0) {
+        fprintf(stderr, "警告: 写入热力图 '%s' 失败: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+// 输出延迟分布统计，prefix 用于日志文件中的注释前缀
+void print_latency_distribution(FILE *out, const char *prefix, const LatencyHistogram *hist) {
+    static const double percentiles[] = { 50, 90, 99, 99.9, 99.99 };
+    char latency[32];
+
+    fprintf(out, "%s------------------------\n", prefix);
+    fprintf(out, "%s延迟分布 (%lu 个样本):\n", prefix, hist->count);
+    if (hist->count == 0) return;
+
+    fprintf(out, "%s  平均: %s", prefix, format_latency(lround(histogram_mean(hist)), latency, sizeof(latency)));
+    fprintf(out, "  标准差: %s", format_latency(lround(histogram_stddev(hist)), latency, sizeof(latency)));
+    fprintf(out, "  最小: %s\n", format_latency(hist->min, latency, sizeof(latency)));
+    fprintf(out, "%s ", prefix);
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+        fprintf(out, " p%g: %s", percentiles[i],
+                format_latency(histogram_percentile(hist, percentiles[i]), latency, sizeof(latency)));
+    }
+    fprintf(out, "  最大: %s\n", format_latency(hist->max, latency, sizeof(latency)));
+}
+
+// 区间按严重程度排序：读取失败多的在前，其次按最严重的状态、最大延迟和长度
+int bad_range_compare_severity(const void *a, const void *b) {
+    const BadRange *x = *(const BadRange * const *)a, *y = *(const BadRange * const *)b;
+    if (x->errors != y->errors) return x->errors > y->errors ? -1 : 1;
+    if (x->worst_status != y->worst_status) return x->worst_status > y->worst_status ? -1 : 1;
+    if (x->worst_latency_us != y->worst_latency_us) return x->worst_latency_us > y->worst_latency_us ? -1 : 1;
+    uint64_t x_len = x->end - x->start, y_len = y->end - y->start;
+    return x_len > y_len ? -1 : x_len < y_len;
+}
+
+// 输出合并后的区间概况和最严重的 top 个区间，prefix 用于日志文件中的注释前缀
+void print_top_ranges(FILE *out, const char *prefix, const ScanLogger *logger, const DeviceInfo *info,
+                      int top) {
+    const RangeIndex *ranges = &logger->slow_ranges;
+    if (ranges->count == 0 && ranges->dropped == 0) return;
+
+    unsigned long records = 0;
+    for (size_t i = 0; i < ranges->count; i++) records += ranges->ranges[i].records;
+    fprintf(out, "%s------------------------\n", prefix);
+    fprintf(out, "%s慢块区间: %zu 个 (由 %lu 条记录合并)，含读取错误或坏道的区间: %zu 个\n",
+            prefix, ranges->count, records, logger->bad_ranges.count);
+    if (ranges->dropped > 0 || logger->bad_ranges.dropped > 0) {
+        fprintf(out, "%s注意: 区间数超过上限，%lu 条记录未能合并\n", prefix, ranges->dropped);
+    }
+
+    size_t count = (top > 0 && (size_t)top < ranges->count) ? (size_t)top : ranges->count;
+    if (top <= 0 || count == 0) return;
+    const BadRange **sorted = malloc(ranges->count * sizeof(*sorted));
+    if (!sorted) return;
+    for (size_t i = 0; i < ranges->count; i++) sorted[i] = &ranges->ranges[i];
+    qsort(sorted, ranges->count, sizeof(*sorted), bad_range_compare_severity);
+
+    char latency[32];
+    fprintf(out, "%s最严重的 %zu 个区间:\n", prefix, count);
+    for (size_t i = 0; i < count; i++) {
+        const BadRange *range = sorted[i];
+        uint64_t sectors = range->end - range->start;
+        fprintf(out, "%s  %2zu. 扇区 %lu - %lu (%lu 扇区, %.2f MB) 记录 %u 条",
+                prefix, i + 1, (unsigned long)range->start, (unsigned long)(range->end - 1),
+                (unsigned long)sectors, (double)sectors * info->sector_size / (1024 * 1024), range->records);
+        if (range->errors > 0) fprintf(out, "，读取失败 %u 条", range->errors);
+        fprintf(out, "，最严重: %s", log_status_name(logger->categories, logger->cat_count, range->worst_status));
+        if (range->worst_status < LOG_STATUS_SEEK_ERROR) {
+            fprintf(out, " (%s)", format_latency(range->worst_latency_us, latency, sizeof(latency)));
+        }
+        fprintf(out, "\n");
+    }
+    free(sorted);
+}
+
+// 导出合并后的区间列表：每行一个区间，制表符分隔
+int export_ranges(const char *path, const ScanLogger *logger) {
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "警告: 无法创建区间列表 '%s': %s\n", path, strerror(errno));
+        return -1;
+    }
+    fprintf(out, "# 起始扇区\t结束扇区(含)\t扇区数\t记录数\t读取失败数\t最大延迟(us)\t最严重状态\n");
+    const RangeIndex *ranges = &logger->slow_ranges;
+    for (size_t i = 0; i < ranges->count; i++) {
+        const BadRange *range = &ranges->ranges[i];
+        fprintf(out, "%lu\t%lu\t%lu\t%u\t%u\t%u\t%s\n",
+                (unsigned long)range->start, (unsigned long)(range->end - 1),
+                (unsigned long)(range->end - range->start), range->records, range->errors,
+                range->worst_latency_us,
+                log_status_name(logger->categories, logger->cat_count, range->worst_status));
+    }
+    return fclose(out) == 0 ? 0 : -1;
+}
+
+// 导出坏块列表：读取错误和坏道分类的区间换算成文件系统块号，每行一个，升序且不重复，
+// 与 badblocks -o 的输出格式相同，可用于 e2fsck -l / mke2fs -l。
+// 块号相对于被扫描设备的起点，因此应当扫描文件系统所在的分区而不是整个磁盘
+int export_badblocks(const char *path, const ScanLogger *logger, const DeviceInfo *info, size_t fs_block_size) {
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "警告: 无法创建坏块列表 '%s': %s\n", path, strerror(errno));
+        return -1;
+    }
+    const RangeIndex *ranges = &logger->bad_ranges;
+    uint64_t next = 0;      // 下一个可以输出的块号，避免相邻区间落在同一块时重复
+    unsigned long written = 0;
+    for (size_t i = 0; i < ranges->count; i++) {
+        uint64_t first = ranges->ranges[i].start * info->sector_size / fs_block_size;
+        uint64_t last = (ranges->ranges[i].end * info->sector_size - 1) / fs_block_size;
+        if (first < next) first = next;
+        for (uint64_t block = first; block <= last; block++) {
+            fprintf(out, "%lu\n", (unsigned long)block);
+            written++;
+        }
+        if (last + 1 > next) next = last + 1;
+    }
+    if (fclose(out) != 0) return -1;
+    printf("坏块列表: %lu 个 %zu 字节的文件系统块，已写入 %s\n", written, fs_block_size, path);
+    return 0;
+}
+
+// 生成最终报告
+void generate_final_report(const ScanOptions *opts, const DeviceInfo *info,
+                          TimeCategory *categories, int cat_count,
+                          const ScanStats *stats, const ScanLogger *logger,
+                          struct timespec *start_time, FILE *logfile) {
+    // 计算总时间
+    struct timespec global_end;
+    clock_gettime(CLOCK_MONOTONIC, &global_end);
+    double total_sec = (global_end.tv_sec - start_time->tv_sec) +
+                      (global_end.tv_nsec - start_time->tv_nsec) / 1000000000.0;
+
+    // 计算实际测试的块数（不包括可疑分类）
+    unsigned long actual_tested_blocks = 0;
+    unsigned long sample_count = (unsigned long)(info->block_count * opts->sample_ratio / 100.0);
+    if (sample_count == 0) sample_count = 1;
+    if (sample_count > info->block_count) sample_count = info->block_count;
+    unsigned long planned_count = sample_count;
+    // 时间预算和加密采样都会改变扫描的块数，以实际扫描的为准
+    if (opts->time_budget > 0 || opts->refine) sample_count = stats->scanned;
+
+    for (int i = 0; i < cat_count; i++) {
+        if (i != cat_count - 2) { // 排除可疑分类
+            actual_tested_blocks += categories[i].count;
+        }
+    }
+
+    // 打印最终报告
+    printf("\n===== 坏道检测报告 =====\n");
+    printf("总扇区数: %lu (%.2f GB)\n", info->sector_count,
+           (double)info->sector_count * info->sector_size / (1024*1024*1024));
+    printf("总块数: %lu\n", info->block_count);
+    printf("抽样扫描块数: %lu (%.2f%%)\n", sample_count,
+           100.0 * sample_count / info->block_count);
+    if (opts->time_budget > 0) {
+        printf("时间预算: %ld 秒 (计划 %lu 块 %.2f%%，实际采样比例 %.2f%%)\n", opts->time_budget,
+               planned_count, 100.0 * planned_count / info->block_count,
+               100.0 * sample_count / info->block_count);
+    }
+    printf("实际测试块数: %lu\n", actual_tested_blocks);
+    if (opts->random_sampling) {
+        printf("随机种子: %llu (用 --seed 复现本次采样)\n", (unsigned long long)opts->seed);
+    }
+    printf("总扫描时间: %.1f 秒\n", total_sec);
+
+    if (total_sec > 0) {
+        double mb_speed = (sample_count * opts->block_size) / (total_sec * 1024 * 1024);
+        printf("平均速度: %.1f MB/s\n", mb_speed);
+    }
+
+    printf("------------------------\n");
+
+    char latency[32];
+    for (int i = 0; i < cat_count; i++) {
+        if (i == cat_count - 2) {
+            // 可疑分类单独处理
+            printf("%s%-6s\033[0m (>%6s): %8lu 块 (重测后重新分类)\n",
+                   categories[i].color, categories[i].name,
+                   format_latency(opts->suspect_threshold, latency, sizeof(latency)),
+                   categories[i].count);
+        } else if (i < cat_count - 2) {
+            printf("%s%-6s\033[0m (≤%6s): %8lu 块 (%5.2f%%)\n",
+                   categories[i].color, categories[i].name,
+                   format_latency(categories[i].max_time, latency, sizeof(latency)),
+                   categories[i].count,
+                   actual_tested_blocks > 0 ? 100.0 * categories[i].count / actual_tested_blocks : 0.0);
+        } else {
+            // 坏道分类
+            printf("%s%-6s\033[0m (>%6s): %8lu 块 (%5.2f%%)\n",
+                   categories[i].color, categories[i].name,
+                   format_latency(cat_count > 2 ? categories[cat_count-3].max_time : 3000 * US_PER_MS,
+                                  latency, sizeof(latency)),
+                   categories[i].count,
+                   actual_tested_blocks > 0 ? 100.0 * categories[i].count / actual_tested_blocks : 0.0);
+        }
+    }
+
+    if (opts->fine_block_size > 0) {
+        printf("------------------------\n");
+        printf("分层定位 (粒度 %zu 字节): 细分读取 %lu 次，慢区间 %lu 个，读取错误区间 %lu 个\n",
+               opts->fine_block_size, stats->bisect_reads, stats->located_slow, stats->located_errors);
+    }
+    if (stats->retested > 0) {
+        printf("可疑块重测: %lu 个，重测读取 %lu 次 (平均 %.1f 次/个%s)\n",
+               stats->retested, stats->retest_reads, (double)stats->retest_reads / stats->retested,
+               opts->adaptive_retest ? "，自适应" : "");
+    }
+    if (stats->refine_regions > 0) {
+        printf("自适应加密采样: %lu 个区域，追加 %lu 个样本\n",
+               stats->refine_regions, stats->refine_samples);
+    }
+
+    print_latency_distribution(stdout, "", &stats->histogram);
+    if (logger) print_top_ranges(stdout, "", logger, info, opts->top_ranges);
+    if (opts->heatmap_file) print_heatmap_ascii(stdout, stats, info);
+
+    // 写入日志统计
+    if (logfile) {
+        fprintf(logfile, "# ========== 扫描统计 ==========\n");
+        fprintf(logfile, "# 总扇区数: %lu\n", info->sector_count);
+        fprintf(logfile, "# 总块数: %lu\n", info->block_count);
+        fprintf(logfile, "# 抽样扫描块数: %lu (%.2f%%)\n", sample_count,
+                100.0 * sample_count / info->block_count);
+        if (opts->time_budget > 0) {
+            fprintf(logfile, "# 时间预算: %ld 秒 (计划 %lu 块，实际采样比例 %.2f%%)\n", opts->time_budget,
+                    planned_count, 100.0 * sample_count / info->block_count);
+        }
+        fprintf(logfile, "# 实际测试块数: %lu\n", actual_tested_blocks);
+        if (opts->random_sampling) {
+            fprintf(logfile, "# 随机种子: %llu\n", (unsigned long long)opts->seed);
+        }
+        fprintf(logfile, "# 总扫描时间: %.1f 秒\n", total_sec);
+
+        if (total_sec > 0) {
+            double mb_speed = (sample_count * opts->block_size) / (total_sec * 1024 * 1024);
+            fprintf(logfile, "# 平均速度: %.1f MB/s\n", mb_speed);
+        }
+
+        fprintf(logfile, "# ------------------------\n");
+        for (int i = 0; i < cat_count; i++) {
+            if (i == cat_count - 2) {
+                fprintf(logfile, "# %-6s (> %6s): %8lu (重测后重新分类)\n",
+                       categories[i].name,
+                       format_latency(opts->suspect_threshold, latency, sizeof(latency)),
+                       categories[i].count);
+            } else if (i < cat_count - 2) {
+                fprintf(logfile, "# %-6s (≤ %6s): %8lu (%5.2f%%)\n",
+                       categories[i].name,
+                       format_latency(categories[i].max_time, latency, sizeof(latency)),
+                       categories[i].count,
+                       actual_tested_blocks > 0 ? 100.0 * categories[i].count / actual_tested_blocks : 0.0);
+            } else {
+                fprintf(logfile, "# %-6s (> %6s): %8lu (%5.2f%%)\n",
+                       categories[i].name,
+                       format_latency(cat_count > 2 ? categories[cat_count-3].max_time : 3000 * US_PER_MS,
+                                      latency, sizeof(latency)),
+                       categories[i].count,
+                       actual_tested_blocks > 0 ? 100.0 * categories[i].count / actual_tested_blocks : 0.0);
+            }
+        }
+        if (opts->fine_block_size > 0) {
+            fprintf(logfile, "# ------------------------\n");
+            fprintf(logfile, "# 分层定位 (粒度 %zu 字节): 细分读取 %lu 次，慢区间 %lu 个，读取错误区间 %lu 个\n",
+                    opts->fine_block_size, stats->bisect_reads, stats->located_slow, stats->located_errors);
+        }
+        if (stats->retested > 0) {
+            fprintf(logfile, "# 可疑块重测: %lu 个，重测读取 %lu 次 (平均 %.1f 次/个%s)\n",
+                    stats->retested, stats->retest_reads, (double)stats->retest_reads / stats->retested,
+                    opts->adaptive_retest ? "，自适应" : "");
+        }
+        if (stats->refine_regions > 0) {
+            fprintf(logfile, "# 自适应加密采样: %lu 个区域，追加 %lu 个样本\n",
+                    stats->refine_regions, stats->refine_samples);
+        }
+        print_latency_distribution(logfile, "# ", &stats->histogram);
+        if (logger) print_top_ranges(logfile, "# ", logger, info, opts->top_ranges);
+        fprintf(logfile, "# 扫描完成时间: %ld\n", (long)time(NULL));
+    }
+}
+
+// 以 JSON 数组输出区间列表，结束扇区不含在区间内
+void json_write_ranges(FILE *out, const RangeIndex *ranges, const TimeCategory *categories, int cat_count) {
+    size_t count = ranges ? ranges->count : 0;
+    fputc('[', out);
+    for (size_t i = 0; i < count; i++) {
+        const BadRange *range = &ranges->ranges[i];
+        fprintf(out, "%s\n    {\"start_sector\": %lu, \"end_sector\": %lu, \"records\": %u, \"errors\": %u, "
+                "\"worst_latency_us\": %u, \"worst_status\": ",
+                i > 0 ? "," : "", (unsigned long)range->start, (unsigned long)range->end,
+                range->records, range->errors, range->worst_latency_us);
+        json_write_string(out, log_status_name(categories, cat_count, range->worst_status));
+        fputc('}', out);
+    }
+    fprintf(out, "%s]", count > 0 ? "\n  " : "");
+}
+
+// 把最终报告以 JSON 格式写入 path：设备信息、扫描参数、用时、分类计数、延迟分布和坏块列表。
+// 延迟一律以微秒为单位。区间只包含本次运行记录到的慢块和错误，bad_ranges 为其中的读取错误和坏道
+int write_json_report(const char *path, const ScanOptions *opts, const DeviceInfo *info,
+                      const DeviceTypeInfo *type_info, const TimeCategory *categories, int cat_count,
+                      const ScanStats *stats, const ScanLogger *logger,
+                      const struct timespec *start_time, time_t started_at) {
+    static const char *engine_names[] = { "sync", "uring", "threads" };
+    static const double percentiles[] = { 50, 90, 99, 99.9, 99.99 };
+
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "警告: 无法创建 JSON 报告 '%s': %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double total_sec = timespec_diff_us(start_time, &end) / (double)US_PER_SEC;
+    unsigned long planned = (unsigned long)(info->block_count * opts->sample_ratio / 100.0);
+    if (planned == 0) planned = 1;
+    if (planned > info->block_count) planned = info->block_count;
+
+    fprintf(out, "{\n  \"version\": 1,\n  \"device\": {\"path\": ");
+    json_write_string(out, opts->device);
+    fprintf(out, ", \"type\": ");
+    json_write_string(out, type_info->device_type);
+    fprintf(out, ", \"vendor\": ");
+    json_write_string(out, type_info->vendor);
+    fprintf(out, ", \"model\": ");
+    json_write_string(out, type_info->model);
+    fprintf(out, ", \"rotational\": %s, \"sector_size\": %d, \"total_sectors\": %lu},\n",
+            opts->rotational ? "true" : "false", info->sector_size, info->total_sectors);
+
+    fprintf(out, "  \"range\": {\"start_sector\": %lu, \"end_sector\": %lu, \"sector_count\": %lu, "
+            "\"block_size\": %zu, \"block_count\": %lu},\n",
+            info->start_sector, info->end_sector, info->sector_count, opts->block_size, info->block_count);
+
+    fprintf(out, "  \"options\": {\"engine\": \"%s\", \"queue_depth\": %d, \"threads\": %d, "
+            "\"sample_ratio\": %g, \"random_sampling\": %s, \"seed\": %llu, \"low_discrepancy\": %s, "
+            "\"refine\": %s, \"time_budget_sec\": %ld, \"fine_block_size\": %zu, "
+            "\"log_threshold_us\": %ld, \"suspect_threshold_us\": %ld, \"suspect_retries\": %d, "
+            "\"async_retest\": %s, \"adaptive_retest\": %s, \"resumed\": %s},\n",
+            engine_names[opts->engine], opts->queue_depth, opts->threads, opts->sample_ratio,
+            opts->random_sampling ? "true" : "false", (unsigned long long)opts->seed,
+            opts->low_discrepancy ? "true" : "false", opts->refine ? "true" : "false",
+            opts->time_budget, opts->fine_block_size, opts->log_threshold, opts->suspect_threshold,
+            opts->suspect_retries, opts->async_retest ? "true" : "false",
+            opts->adaptive_retest ? "true" : "false", opts->resume ? "true" : "false");
+
+    fprintf(out, "  \"timing\": {\"started\": %ld, \"finished\": %ld, \"elapsed_sec\": %.3f, "
+            "\"mb_per_sec\": %.3f},\n",
+            (long)started_at, (long)time(NULL), total_sec,
+            total_sec > 0 ? stats->scanned * opts->block_size / (total_sec * 1024 * 1024) : 0.0);
+
+    fprintf(out, "  \"blocks\": {\"planned\": %lu, \"scanned\": %lu, \"retested\": %lu, "
+            "\"retest_reads\": %lu, \"bisect_reads\": %lu, \"located_slow\": %lu, "
+            "\"located_errors\": %lu, \"refine_regions\": %lu, \"refine_samples\": %lu},\n",
+            planned, stats->scanned, stats->retested, stats->retest_reads, stats->bisect_reads,
+            stats->located_slow, stats->located_errors, stats->refine_regions, stats->refine_samples);
+
+    // 可疑分类只是重测前的中间状态，kind 标明各分类的含义
+    fprintf(out, "  \"categories\": [");
+    for (int i = 0; i < cat_count; i++) {
+        const char *kind = i == cat_count - 1 ? "bad" : i == cat_count - 2 ? "suspect" : "normal";
+        long bound = i == cat_count - 2 ? opts->suspect_threshold : categories[i].max_time;
+        fprintf(out, "%s\n    {\"name\": ", i > 0 ? "," : "");
+        json_write_string(out, categories[i].name);
+        fprintf(out, ", \"kind\": \"%s\", \"%s\": %ld, \"count\": %ld}",
+                kind, i < cat_count - 2 ? "max_latency_us" : "min_latency_us", bound, categories[i].count);
+    }
+    fprintf(out, "\n  ],\n");
+
+    const LatencyHistogram *hist = &stats->histogram;
+    fprintf(out, "  \"latency\": {\"count\": %lu, \"mean_us\": %.1f, \"stddev_us\": %.1f, "
+            "\"min_us\": %ld, \"max_us\": %ld, \"percentiles_us\": {",
+            hist->count, histogram_mean(hist), histogram_stddev(hist), hist->count ? hist->min : 0, hist->max);
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+        fprintf(out, "%s\"p%g\": %ld", i > 0 ? ", " : "", percentiles[i], histogram_percentile(hist, percentiles[i]));
+    }
+    // 直方图只列出非空的桶：[桶中点（微秒）, 样本数]
+    fprintf(out, "},\n    \"histogram\": [");
+    int first = 1;
+    for (int i = 0; i < HIST_BUCKET_COUNT; i++) {
+        if (hist->buckets[i] == 0) continue;
+        fprintf(out, "%s[%ld, %lu]", first ? "" : ", ", histogram_bucket_value(i), hist->buckets[i]);
+        first = 0;
+    }
+    fprintf(out, "]},\n");
+
+    fprintf(out, "  \"ranges\": ");
+    json_write_ranges(out, logger ? &logger->slow_ranges : NULL, categories, cat_count);
+    fprintf(out, ",\n  \"bad_ranges\": ");
+    json_write_ranges(out, logger ? &logger->bad_ranges : NULL, categories, cat_count);
+    fprintf(out, ",\n  \"ranges_dropped\": %lu\n}\n", logger ? logger->slow_ranges.dropped : 0);
+
+    if (fclose(out) != 0) {
+        fprintf(stderr, "警告: 写入 JSON 报告 '%s' 失败: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+// 转速校准：用成对的随机读取测量旋转延迟和寻道时间。每对读取先读第一个位置让磁头就位（不计时），
+// 再读第二个位置并计时，访问时间 = 寻道 + 旋转等待（在一圈内均匀分布）+ 传输
+typedef struct {
+    int             fd;
+    void           *buffer;
+    size_t          size;           // 每次读取的字节数
+    off_t           base;           // 扫描范围的起始字节
+    unsigned long   units;          // 扫描范围内可读取的位置数（按 size 划分）
+    uint64_t        rng[4];
+} Calibrator;
+
+// 先读 from 再读 to（以 size 为单位），返回第二次读取的耗时（微秒），失败返回 -1
+long calibrate_pair(Calibrator *c, unsigned long from, unsigned long to) {
+    struct timespec start, end;
+    if (pread(c->fd, c->buffer, c->size, c->base + (off_t)from * c->size) != (ssize_t)c->size) return -1;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ssize_t n = pread(c->fd, c->buffer, c->size, c->base + (off_t)to * c->size);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return n == (ssize_t)c->size ? timespec_diff_us(&start, &end) : -1;
+}
+
+int compare_long(const void *a, const void *b) {
+    long x = *(const long *)a, y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+// 已排序样本的第 p 百分位
+long calibrate_percentile(const long *samples, int count, double p) {
+    int index = (int)(p / 100 * (count - 1) + 0.5);
+    return samples[index];
+}
+
+// 距离约为 distance 个单位的读取对，返回访问时间的截尾平均（去掉两端各 10%，微秒），distance 为 0 表示两个位置都随机。
+// 距离固定时两个位置的角度差也固定，旋转等待不再均匀分布，所以距离再随机加上 [0, jitter) 个单位
+long calibrate_seek(Calibrator *c, unsigned long distance, unsigned long jitter) {
+    long samples[CALIBRATE_SEEK_SAMPLES];
+    int count = 0;
+    for (int i = 0; i < CALIBRATE_SEEK_SAMPLES; i++) {
+        unsigned long from, to;
+        if (distance == 0) {
+            from = rng_below(c->rng, c->units);
+            to = rng_below(c->rng, c->units);
+        } else {
+            unsigned long span = distance + rng_below(c->rng, jitter);
+            from = rng_below(c->rng, c->units - span);
+            to = from + span;
+            if (rng_next(c->rng) & 1) {
+                unsigned long t = from;
+                from = to;
+                to = t;
+            }
+        }
+        long elapsed = calibrate_pair(c, from, to);
+        if (elapsed >= 0) samples[count++] = elapsed;
+    }
+    if (count == 0) return -1;
+    qsort(samples, count, sizeof(long), compare_long);
+    int trim = count / 10;
+    double sum = 0;
+    for (int i = trim; i < count - trim; i++) sum += samples[i];
+    return (long)(sum / (count - 2 * trim));
+}
+
+// 把实测转速归到最接近的常见规格，相差超过 CALIBRATE_RPM_TOLERANCE 时按百位取整
+int calibrate_snap_rpm(double rpm) {
+    static const int standard[] = { 4200, 5400, 5900, 7200, 10000, 15000 };
+    for (size_t i = 0; i < sizeof(standard) / sizeof(standard[0]); i++) {
+        if (fabs(rpm - standard[i]) <= standard[i] * CALIBRATE_RPM_TOLERANCE) return standard[i];
+    }
+    return (int)(rpm / 100 + 0.5) * 100;
+}
+
+// 测量转速和寻道时间并填入 dev_info，供自动分类阈值使用。
+// 旋转延迟：向后跳过几个磁道读取（避开驱动器的预读缓存），寻道时间几乎不变，
+// 访问时间的分布宽度就是一圈的时间，取 p10~p90 的跨度除以 0.8。
+// 寻道时间：各距离的平均访问时间减去平均旋转等待（半圈）。
+// 测到旋转延迟而系统未报告设备类型时（如某些 USB 硬盘盒）按机械硬盘处理
+int calibrate_rotation(const ScanOptions *opts, const DeviceInfo *info, DeviceTypeInfo *dev_info) {
+    if (dev_info->is_rotational == 0) {
+        printf("\033[1;94m【转速校准】\033[m固态硬盘没有旋转延迟，跳过校准\n");
+        return -1;
+    }
+
+    Calibrator c;
+    c.size = CALIBRATE_READ_SIZE > (size_t)info->sector_size ? CALIBRATE_READ_SIZE : (size_t)info->sector_size;
+    c.base = (off_t)info->sector_offset * info->sector_size;
+    c.units = info->block_count * info->sectors_per_block * info->sector_size / c.size;
+    unsigned long skip_min = CALIBRATE_SKIP_MIN / c.size, skip_max = CALIBRATE_SKIP_MAX / c.size;
+    if (c.units < 2 * skip_max) {
+        printf("\033[1;94m【转速校准】\033[m测试范围太小，跳过校准\n");
+        return -1;
+    }
+    rng_seed(c.rng, opts->seed, MAX_THREADS);
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    size_t align_size = (info->sector_size > page_size) ? info->sector_size : page_size;
+    c.fd = open(opts->device, O_RDONLY | O_DIRECT);
+    if (c.fd == -1 || posix_memalign(&c.buffer, align_size, c.size)) {
+        fprintf(stderr, "警告: 无法打开设备用于校准: %s\n", strerror(errno));
+        if (c.fd != -1) close(c.fd);
+        return -1;
+    }
+
+    printf("\033[1;94m【转速校准】\033[m正在测量旋转延迟和寻道时间...\n");
+    long samples[CALIBRATE_ROTATION_SAMPLES];
+    int count = 0;
+    for (int i = 0; i < CALIBRATE_ROTATION_SAMPLES; i++) {
+        unsigned long skip = skip_min + rng_below(c.rng, skip_max - skip_min);
+        unsigned long from = skip + rng_below(c.rng, c.units - skip);
+        long elapsed = calibrate_pair(&c, from, from - skip);
+        if (elapsed >= 0) samples[count++] = elapsed;
+    }
+
+    int result = -1;
+    double period_us = 0;
+    if (count >= CALIBRATE_ROTATION_SAMPLES / 2) {
+        qsort(samples, count, sizeof(long), compare_long);
+        period_us = (calibrate_percentile(samples, count, 90) - calibrate_percentile(samples, count, 10)) / 0.8;
+    }
+    double rpm = period_us > 0 ? 60.0 * US_PER_SEC / period_us : 0;
+    char latency[32], seek[32];
+    if (rpm < CALIBRATE_MIN_RPM || rpm > CALIBRATE_MAX_RPM) {
+        printf("\033[1;94m【转速校准】\033[m未测到稳定的旋转延迟（访问时间分布宽度 %s），保持转速未知\n",
+               format_latency((long)period_us, latency, sizeof(latency)));
+    } else {
+        dev_info->rpm = calibrate_snap_rpm(rpm);
+        if (dev_info->is_rotational == -1) {
+            dev_info->is_rotational = 1;
+            strcpy(dev_info->device_type, "HDD");
+        }
+        printf("\033[1;94m【转速校准】\033[m旋转周期: %s → %d RPM (实测 %.0f RPM)\n",
+               format_latency((long)period_us, latency, sizeof(latency)), dev_info->rpm, rpm);
+
+        // 距离按 4 倍递增，最后一档为整个测试范围（满行程）
+        long half_turn = (long)(period_us / 2);
+        unsigned long max_distance = c.units - skip_max;
+        printf("\033[1;94m【转速校准】\033[m  寻道距离      访问时间    寻道时间\n");
+        for (int k = 0; k < CALIBRATE_SEEK_DISTANCES; k++) {
+            unsigned long distance = max_distance >> (2 * (CALIBRATE_SEEK_DISTANCES - 1 - k));
+            if (distance == 0) continue;
+            long access = calibrate_seek(&c, distance, skip_max);
+            if (access < 0) continue;
+            long seek_us = access > half_turn ? access - half_turn : 0;
+            if (k == CALIBRATE_SEEK_DISTANCES - 1) dev_info->full_seek_us = seek_us;
+            printf("\033[1;94m【转速校准】\033[m  %8.3f%%  %12s  %10s\n", 100.0 * distance / c.units,
+                   format_latency(access, latency, sizeof(latency)), format_latency(seek_us, seek, sizeof(seek)));
+        }
+
+        long access = calibrate_seek(&c, 0, 0);
+        long avg_seek_us = access > half_turn ? access - half_turn : 0;
+        printf("\033[1;94m【转速校准】\033[m平均寻道: %s | 满行程寻道: %s\n",
+               format_latency(avg_seek_us, latency, sizeof(latency)),
+               format_latency(dev_info->full_seek_us, seek, sizeof(seek)));
+        double scale = rotational_latency_scale(dev_info);
+        if (scale != 1) {
+            printf("\033[1;94m【转速校准】\033[m最坏机械访问 (满行程寻道 + 一圈): %s，自动分类阈值按 %.2f 倍缩放\n",
+                   format_latency(dev_info->full_seek_us + 60L * US_PER_SEC / dev_info->rpm, latency, sizeof(latency)),
+                   scale);
+        }
+        result = 0;
+    }
 
-    // 写入日志统计
-    if (logfile) {
-        fprintf(logfile, "# ========== 扫描统计 ==========\n");
-        fprintf(logfile, "# 总扇区数: %lu\n", info->sector_count);
-        fprintf(logfile, "# 总块数: %lu\n", info->block_count);
-        fprintf(logfile, "# 抽样扫描块数: %lu (%.2f%%)\n", sample_count,
-                100.0 * sample_count / info->block_count);
-        fprintf(logfile, "# 实际测试块数: %lu\n", actual_tested_blocks);
-        fprintf(logfile, "# 总扫描时间: %.1f 秒\n", total_sec);
+    close(c.fd);
+    free(c.buffer);
+    return result;
+}
 
-        if (total_sec > 0) {
-            double mb_speed = (sample_count * opts->block_size) / (total_sec * 1024 * 1024);
-            fprintf(logfile, "# 平均速度: %.1f MB/s\n", mb_speed);
+// 吞吐曲线模式：把扫描范围按块号等分为若干窗口，每个窗口从开头顺序读取一段（-s 指定的比例），
+// 读取用大块请求经 io_uring 保持多个在途，得到各位置的持续传输速度
+typedef struct {
+    unsigned long   start_sector;
+    unsigned long   end_sector;     // 不含
+    unsigned long   bytes;          // 成功读取的字节数
+    unsigned long   errors;         // 失败的读请求数
+    double          seconds;
+    double          rate;           // 实测速度（MB/s）
+    double          expected;       // 拟合曲线在窗口中心的速度（MB/s）
+    int             dip;            // 1=速度低于拟合曲线的 PROFILE_DIP_RATIO
+} ProfileWindow;
+
+typedef struct {
+    int             fd;
+    size_t          chunk;          // 单个读请求的字节数
+    unsigned        depth;          // 0 表示 io_uring 不可用，改用同步读取
+    UringQueue      ring;
+    struct iovec   *iov;            // 每个在途请求一个缓冲区
+    unsigned       *free_slots;
+    void           *buffers;
+} ProfileReader;
+
+// 读取 [offset, offset + length)，累计成功字节数、失败请求数和从第一个请求提交到最后一个完成的时间。
+// io_uring 提交失败时等在途请求全部完成后返回 -1
+int profile_read_window(ProfileReader *reader, off_t offset, off_t length, ProfileWindow *window) {
+    off_t next = offset, end = offset + length;
+    struct timespec start, finish;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (reader->depth == 0) {
+        while (next < end) {
+            size_t len = (end - next < (off_t)reader->chunk) ? (size_t)(end - next) : reader->chunk;
+            if (pread(reader->fd, reader->buffers, len, next) == (ssize_t)len) {
+                window->bytes += len;
+            } else {
+                window->errors++;
+            }
+            next += len;
         }
+    } else {
+        unsigned free_count = reader->depth;
+        unsigned inflight = 0;
+        unsigned unsubmitted = 0;
+        int failed = 0;     // 提交失败后不再提交，收割完在途请求后放弃整个曲线
+        while ((!failed && (next < end || unsubmitted > 0)) || inflight > 0) {
+            while (!failed && free_count > 0 && next < end) {
+                unsigned id = reader->free_slots[--free_count];
+                size_t len = (end - next < (off_t)reader->chunk) ? (size_t)(end - next) : reader->chunk;
+                reader->iov[id].iov_len = len;
+                uring_prep_readv(&reader->ring, reader->fd, &reader->iov[id], next, id);
+                next += len;
+                unsubmitted++;
+            }
 
-        fprintf(logfile, "# ------------------------\n");
-        for (int i = 0; i < cat_count; i++) {
-            if (i == cat_count - 2) {
-                fprintf(logfile, "# %-6s (> %4d ms): %8lu (重测后重新分类)\n",
-                       categories[i].name, opts->suspect_threshold, categories[i].count);
-            } else if (i < cat_count - 2) {
-                fprintf(logfile, "# %-6s (≤ %4ld ms): %8lu (%5.2f%%)\n",
-                       categories[i].name, categories[i].max_time,
-                       categories[i].count,
-                       actual_tested_blocks > 0 ? 100.0 * categories[i].count / actual_tested_blocks : 0.0);
+            int submitted = uring_submit_and_wait(&reader->ring, failed ? 0 : unsubmitted, 1);
+            if (submitted < 0) {
+                if (failed) {
+                    // 无法等待在途请求完成，内核可能仍在写入缓冲区，只能不释放
+                    perror("等待 io_uring 在途请求失败");
+                    reader->buffers = NULL;
+                    reader->iov = NULL;
+                    return -1;
+                }
+                perror("io_uring 提交失败");
+                failed = 1;
+                continue;
+            }
+            unsubmitted -= submitted;
+            inflight += submitted;
+
+            unsigned head = *reader->ring.cq_head;
+            while (head != __atomic_load_n(reader->ring.cq_tail, __ATOMIC_ACQUIRE)) {
+                struct io_uring_cqe *cqe = &reader->ring.cqes[head & *reader->ring.cq_mask];
+                unsigned id = (unsigned)cqe->user_data;
+                if (cqe->res == (int)reader->iov[id].iov_len) {
+                    window->bytes += cqe->res;
+                } else {
+                    window->errors++;
+                }
+                head++;
+                __atomic_store_n(reader->ring.cq_head, head, __ATOMIC_RELEASE);
+                reader->free_slots[free_count++] = id;
+                inflight--;
+            }
+        }
+        if (failed) return -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &finish);
+    window->seconds += timespec_diff_us(&start, &finish) / (double)US_PER_SEC;
+    return 0;
+}
+
+int profile_reader_open(ProfileReader *reader, const ScanOptions *opts, const DeviceInfo *info) {
+    memset(reader, 0, sizeof(*reader));
+    reader->chunk = (PROFILE_MIN_CHUNK + opts->block_size - 1) / opts->block_size * opts->block_size;
+    reader->fd = open(opts->device, O_RDONLY | O_DIRECT);
+    if (reader->fd == -1) {
+        fprintf(stderr, "错误: 无法打开设备 '%s': %s\n", opts->device, strerror(errno));
+        return -1;
+    }
+
+    unsigned depth = (unsigned)opts->queue_depth;
+    if (uring_queue_init(&reader->ring, depth) == 0) {
+        reader->depth = depth < reader->ring.entries ? depth : reader->ring.entries;
+    } else {
+        fprintf(stderr, "警告: io_uring 初始化失败 (%s)，回退到同步读取\n", strerror(errno));
+    }
+
+    unsigned slots = reader->depth > 0 ? reader->depth : 1;
+    long page_size = sysconf(_SC_PAGESIZE);
+    size_t align_size = (info->sector_size > page_size) ? info->sector_size : page_size;
+    reader->iov = calloc(slots, sizeof(struct iovec));
+    reader->free_slots = malloc(slots * sizeof(unsigned));
+    if (!reader->iov || !reader->free_slots ||
+        posix_memalign(&reader->buffers, align_size, slots * reader->chunk)) {
+        perror("内存分配失败");
+        return -1;
+    }
+    for (unsigned i = 0; i < slots; i++) {
+        reader->iov[i].iov_base = (char *)reader->buffers + (size_t)i * reader->chunk;
+        reader->free_slots[i] = slots - 1 - i;
+    }
+    return 0;
+}
+
+void profile_reader_close(ProfileReader *reader) {
+    if (reader->depth > 0) uring_queue_exit(&reader->ring);
+    if (reader->fd != -1) close(reader->fd);
+    free(reader->iov);
+    free(reader->free_slots);
+    free(reader->buffers);
+}
+
+// 拟合速度曲线并标记凹陷窗口。机械硬盘按 速度² = a + b·x 拟合（同剩余时间估计），其他设备按水平线。
+// 先用全部窗口拟合，再排除低于拟合值 PROFILE_DIP_RATIO 的窗口重新拟合，避免凹陷把曲线拉低
+int profile_fit(ProfileWindow *windows, int count, int rotational, double *fit_a, double *fit_b) {
+    double *x = malloc(count * sizeof(double));
+    double *rate = malloc(count * sizeof(double));
+    double *weight = malloc(count * sizeof(double));
+    int result = -1;
+    if (x && rate && weight) {
+        for (int i = 0; i < count; i++) {
+            x[i] = rotational ? (i + 0.5) / count : 0;
+            rate[i] = windows[i].rate;
+            weight[i] = windows[i].bytes;
+        }
+        for (int pass = 0; pass < 2; pass++) {
+            if (fit_rate_curve(x, rate, weight, count, fit_a, fit_b) != 0) break;
+            result = 0;
+            for (int i = 0; i < count; i++) {
+                double rate_sq = *fit_a + *fit_b * x[i];
+                windows[i].expected = rate_sq > 0 ? sqrt(rate_sq) : 0;
+                windows[i].dip = windows[i].errors > 0 ||
+                                 windows[i].rate < PROFILE_DIP_RATIO * windows[i].expected;
+                if (windows[i].dip) weight[i] = 0;
+            }
+        }
+    }
+    free(x);
+    free(rate);
+    free(weight);
+    return result;
+}
+
+// 以字符画显示速度曲线：'#' 为实测速度，'-' 为拟合曲线，凹陷所在的列用 '!' 标出
+void print_profile_ascii(FILE *out, const ProfileWindow *windows, int count) {
+    int columns = count < PROFILE_ASCII_COLUMNS ? count : PROFILE_ASCII_COLUMNS;
+    double measured[PROFILE_ASCII_COLUMNS], expected[PROFILE_ASCII_COLUMNS];
+    int dip[PROFILE_ASCII_COLUMNS];
+    double max_rate = 0;
+
+    // 每列取所含窗口中最低的实测速度，避免凹陷被平均掉
+    for (int c = 0; c < columns; c++) {
+        int first = c * count / columns, last = (c + 1) * count / columns;
+        measured[c] = windows[first].rate;
+        expected[c] = 0;
+        dip[c] = 0;
+        for (int i = first; i < last; i++) {
+            if (windows[i].rate < measured[c]) measured[c] = windows[i].rate;
+            expected[c] += windows[i].expected / (last - first);
+            dip[c] |= windows[i].dip;
+            if (windows[i].rate > max_rate) max_rate = windows[i].rate;
+            if (windows[i].expected > max_rate) max_rate = windows[i].expected;
+        }
+    }
+    if (max_rate <= 0) return;
+
+    fprintf(out, "------------------------\n");
+    fprintf(out, "吞吐曲线 (纵轴: MB/s; 横轴: 扇区 %lu ~ %lu):\n",
+            windows[0].start_sector, windows[count - 1].end_sector);
+    for (int r = PROFILE_ASCII_ROWS; r >= 1; r--) {
+        double level = max_rate * r / PROFILE_ASCII_ROWS;
+        double step = max_rate / PROFILE_ASCII_ROWS;
+        fprintf(out, "%8.1f |", level);
+        for (int c = 0; c < columns; c++) {
+            char cell = ' ';
+            if (measured[c] >= level - step / 2) {
+                cell = '#';
+            } else if (expected[c] >= level - step / 2 && expected[c] < level + step / 2) {
+                cell = '-';
+            }
+            fputc(cell, out);
+        }
+        fprintf(out, "|\n");
+    }
+    fprintf(out, "         +");
+    for (int c = 0; c < columns; c++) fputc(dip[c] ? '!' : '-', out);
+    fprintf(out, "+\n");
+}
+
+// 保存吞吐曲线，扩展名为 .json 时输出 JSON，其他为 CSV
+int write_profile(const char *path, const ScanOptions *opts, const DeviceInfo *info, size_t chunk,
+                  const ProfileWindow *windows, int count, int fitted, double fit_a, double fit_b) {
+    const char *ext = strrchr(path, '.');
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "警告: 无法创建吞吐曲线文件 '%s': %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    if (ext && strcmp(ext, ".json") == 0) {
+        fprintf(out, "{\n  \"device\": ");
+        json_write_string(out, opts->device);
+        fprintf(out, ",\n  \"sector_size\": %d,\n  \"chunk_size\": %zu,\n  \"sample_ratio\": %g,\n",
+                info->sector_size, chunk, opts->sample_ratio);
+        fprintf(out, "  \"rotational\": %s,\n  \"dip_ratio\": %g,\n",
+                opts->rotational ? "true" : "false", PROFILE_DIP_RATIO);
+        if (fitted) {
+            fprintf(out, "  \"fit\": {\"a\": %.6g, \"b\": %.6g},\n", fit_a, fit_b);
+        } else {
+            fprintf(out, "  \"fit\": null,\n");
+        }
+        fprintf(out, "  \"windows\": [");
+        for (int i = 0; i < count; i++) {
+            const ProfileWindow *w = &windows[i];
+            fprintf(out, "%s\n    {\"start_sector\": %lu, \"end_sector\": %lu, \"bytes\": %lu, "
+                    "\"seconds\": %.6f, \"mb_per_sec\": %.3f, \"expected_mb_per_sec\": %.3f, "
+                    "\"errors\": %lu, \"dip\": %s}",
+                    i > 0 ? "," : "", w->start_sector, w->end_sector, w->bytes, w->seconds,
+                    w->rate, w->expected, w->errors, w->dip ? "true" : "false");
+        }
+        fprintf(out, "\n  ]\n}\n");
+    } else {
+        fprintf(out, "start_sector,end_sector,bytes,seconds,mb_per_sec,expected_mb_per_sec,errors,dip\n");
+        for (int i = 0; i < count; i++) {
+            const ProfileWindow *w = &windows[i];
+            fprintf(out, "%lu,%lu,%lu,%.6f,%.3f,%.3f,%lu,%d\n", w->start_sector, w->end_sector,
+                    w->bytes, w->seconds, w->rate, w->expected, w->errors, w->dip);
+        }
+    }
+
+    if (fclose(out) != 0) {
+        fprintf(stderr, "警告: 写入吞吐曲线文件 '%s' 失败: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+// 吞吐曲线模式的入口：逐个窗口读取，输出汇总、凹陷区间和字符画，并按 --profile 保存曲线。
+// 中断时保留已测的窗口
+int run_throughput_profile(const ScanOptions *opts, const DeviceInfo *info) {
+    int count = opts->profile_windows;
+    if ((unsigned long)count > info->block_count) count = (int)info->block_count;
+    if (count < 1) {
+        fprintf(stderr, "错误: 扫描范围为空\n");
+        return 1;
+    }
+
+    ProfileReader reader;
+    ProfileWindow *windows = calloc(count, sizeof(ProfileWindow));
+    if (!windows || profile_reader_open(&reader, opts, info) != 0) {
+        if (!windows) perror("内存分配失败");
+        else profile_reader_close(&reader);
+        free(windows);
+        return 1;
+    }
+    install_interrupt_handler();
+
+    printf("\033[35m【吞吐曲线】\033[m窗口: %d 个 | 每窗口读取: %.1f%% | 请求大小: %zu 字节 | %s\n",
+           count, opts->sample_ratio, reader.chunk, reader.depth > 0 ? "io_uring" : "同步读取");
+    if (reader.depth > 0) printf("\033[35m【吞吐曲线】\033[m队列深度: %u\n", reader.depth);
+    printf("====================================================================================================\n");
+
+    int measured = 0;
+    int result = 0;
+    for (int i = 0; i < count && !scan_interrupted; i++) {
+        ProfileWindow *w = &windows[i];
+        unsigned long first = info->block_count * i / count;
+        unsigned long last = info->block_count * (i + 1) / count;
+        w->start_sector = info->start_sector + first * info->sectors_per_block;
+        w->end_sector = info->start_sector + last * info->sectors_per_block;
+
+        // 每个窗口至少读一个完整请求，读取长度按块对齐
+        unsigned long blocks = last - first;
+        unsigned long read_blocks = (unsigned long)ceil(blocks * opts->sample_ratio / 100.0);
+        unsigned long min_blocks = reader.chunk / opts->block_size;
+        if (read_blocks < min_blocks) read_blocks = min_blocks;
+        if (read_blocks > blocks) read_blocks = blocks;
+
+        off_t offset = (off_t)(first * info->sectors_per_block + info->sector_offset) * info->sector_size;
+        if (profile_read_window(&reader, offset, (off_t)(read_blocks * opts->block_size), w) != 0) {
+            result = 1;
+            break;
+        }
+        w->rate = w->seconds > 0 ? w->bytes / (w->seconds * 1024 * 1024) : 0;
+        measured++;
+
+        printf("\r进度: %5.1f%% | 窗口: %d/%d | 扇区: %lu | 速度: %.1f MB/s%s   ",
+               100.0 * measured / count, measured, count, w->start_sector, w->rate,
+               w->errors > 0 ? " (读取错误)" : "");
+        fflush(stdout);
+    }
+    printf("\n\n");
+    profile_reader_close(&reader);
+
+    if (scan_interrupted) {
+        printf("\033[33m【吞吐曲线】\033[m已中断，只输出已测的 %d 个窗口\n", measured);
+    }
+    if (measured == 0) {
+        free(windows);
+        return 1;
+    }
+
+    double fit_a = 0, fit_b = 0;
+    int fitted = profile_fit(windows, measured, opts->rotational, &fit_a, &fit_b) == 0;
+
+    double total_bytes = 0, total_sec = 0, min_rate = windows[0].rate, max_rate = 0;
+    unsigned long errors = 0;
+    int dips = 0;
+    for (int i = 0; i < measured; i++) {
+        total_bytes += windows[i].bytes;
+        total_sec += windows[i].seconds;
+        errors += windows[i].errors;
+        dips += windows[i].dip;
+        if (windows[i].rate < min_rate) min_rate = windows[i].rate;
+        if (windows[i].rate > max_rate) max_rate = windows[i].rate;
+    }
+
+    printf("吞吐曲线报告\n");
+    printf("------------------------\n");
+    printf("平均速度: %.1f MB/s | 最低: %.1f MB/s | 最高: %.1f MB/s\n",
+           total_sec > 0 ? total_bytes / (total_sec * 1024 * 1024) : 0, min_rate, max_rate);
+    if (fitted) {
+        printf("拟合曲线: 起点 %.1f MB/s → 终点 %.1f MB/s\n",
+               windows[0].expected, windows[measured - 1].expected);
+    }
+    if (errors > 0) printf("读取错误: %lu 个请求\n", errors);
+
+    // 相邻的凹陷窗口合并为一个区间，显示区间内最低速度与拟合值之比
+    printf("凹陷区间 (低于拟合曲线 %.0f%%): %d 个窗口\n", PROFILE_DIP_RATIO * 100, dips);
+    int shown = 0;
+    for (int i = 0; i < measured && shown < opts->top_ranges; i++) {
+        if (!windows[i].dip) continue;
+        int worst = i, j = i;
+        while (j + 1 < measured && windows[j + 1].dip) {
+            j++;
+            if (windows[j].rate * windows[worst].expected < windows[worst].rate * windows[j].expected) worst = j;
+        }
+        printf("  扇区 %lu - %lu: 最低 %.1f MB/s，拟合 %.1f MB/s (%.0f%%)%s\n",
+               windows[i].start_sector, windows[j].end_sector, windows[worst].rate, windows[worst].expected,
+               windows[worst].expected > 0 ? 100 * windows[worst].rate / windows[worst].expected : 0,
+               windows[worst].errors > 0 ? "，有读取错误" : "");
+        shown++;
+        i = j;
+    }
+    print_profile_ascii(stdout, windows, measured);
+
+    if (strcmp(opts->profile_file, "-") != 0 && write_profile(opts->profile_file, opts, info, reader.chunk,
+                                            windows, measured, fitted, fit_a, fit_b) != 0) {
+        result = 1;
+    }
+    free(windows);
+    return (result || scan_interrupted) ? 1 : 0;
+}
+
+// 基准测试：在测试范围内扫描队列深度 × 块大小的组合，测量每个组合的 IOPS、MB/s 和 p99 延迟，
+// 推荐 p99 不超过延迟上限时扫描速度最快的参数，并按设备型号保存供以后的扫描使用
+typedef struct {
+    size_t          block_size;
+    int             queue_depth;
+    int             measured;
+    unsigned long   ios;
+    unsigned long   errors;
+    double          iops;
+    double          mb_per_sec;
+    long            p99_us;
+} BenchCell;
+
+// 按型号保存的推荐参数
+typedef struct {
+    size_t          block_size;
+    int             queue_depth;
+    int             threads;
+    double          mb_per_sec;
+    long            p99_us;
+} BenchResult;
+
+typedef struct {
+    int             fd;
+    UringQueue      ring;
+    unsigned        max_depth;      // 0 表示 io_uring 不可用，只测同步读取
+    void           *buffer;         // 所有请求共用一个缓冲区，读到的数据不使用
+    struct iovec    iov[BENCH_MAX_DEPTH];
+    struct timespec submit_time[BENCH_MAX_DEPTH];
+    off_t           base;           // 测试范围的起始字节
+    off_t           range_bytes;
+    int             random;         // 1=随机位置（抽样扫描），0=顺序读取（全盘扫描）
+    long            cell_us;
+    uint64_t        rng[4];
+} BenchContext;
+
+// 下一个请求的位置：顺序模式连续读取（到范围末尾回绕），随机模式取随机的对齐位置
+off_t bench_next_offset(BenchContext *b, const BenchCell *cell, unsigned long *position, unsigned long units) {
+    unsigned long unit = b->random ? rng_below(b->rng, units) : *position;
+    *position = (*position + 1 < units) ? *position + 1 : 0;
+    return b->base + (off_t)unit * cell->block_size;
+}
+
+// 测量一个组合，顺序模式从随机位置开始。到时后不再提交新请求，
+// 在途请求完成后结束，速度按从开始到最后一个请求完成的时间计算。
+// io_uring 提交失败时等在途请求全部完成后返回 -1
+int bench_measure_cell(BenchContext *b, BenchCell *cell) {
+    static LatencyHistogram hist;
+    histogram_init(&hist);
+    unsigned long units = b->range_bytes / cell->block_size;
+    unsigned long position = rng_below(b->rng, units);
+    unsigned long bytes = 0;
+    unsigned depth = (unsigned)cell->queue_depth;
+    unsigned free_slots[BENCH_MAX_DEPTH];
+    unsigned pending[BENCH_MAX_DEPTH];
+    unsigned free_count = depth, inflight = 0, unsubmitted = 0;
+    int failed = 0;     // 提交失败后不再提交，收割完在途请求后放弃测试
+    for (unsigned i = 0; i < depth; i++) free_slots[i] = i;
+
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    now = start;
+    while (1) {
+        int stop = timespec_diff_us(&start, &now) >= b->cell_us || scan_interrupted;
+
+        if (b->max_depth == 0) {
+            if (stop) break;
+            struct timespec submit_time = now;
+            ssize_t n = pread(b->fd, b->buffer, cell->block_size, bench_next_offset(b, cell, &position, units));
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (n == (ssize_t)cell->block_size) {
+                histogram_record(&hist, timespec_diff_us(&submit_time, &now));
+                bytes += n;
             } else {
-                fprintf(logfile, "# %-6s (> %4ld ms): %8lu (%5.2f%%)\n",
-                       categories[i].name,
-                       cat_count > 2 ? categories[cat_count-3].max_time : 3000,
-                       categories[i].count,
-                       actual_tested_blocks > 0 ? 100.0 * categories[i].count / actual_tested_blocks : 0.0);
+                cell->errors++;
             }
+            cell->ios++;
+            continue;
+        }
+
+        unsigned pending_count = 0;
+        while (!stop && !failed && free_count > 0) {
+            unsigned id = free_slots[--free_count];
+            b->iov[id].iov_len = cell->block_size;
+            uring_prep_readv(&b->ring, b->fd, &b->iov[id], bench_next_offset(b, cell, &position, units), id);
+            pending[pending_count++] = id;
+        }
+        if (failed ? inflight == 0 : inflight + unsubmitted + pending_count == 0) break;
+
+        struct timespec submit_time;
+        clock_gettime(CLOCK_MONOTONIC, &submit_time);
+        for (unsigned i = 0; i < pending_count; i++) {
+            b->submit_time[pending[i]] = submit_time;
+        }
+        unsubmitted += pending_count;
+
+        int submitted = uring_submit_and_wait(&b->ring, failed ? 0 : unsubmitted, 1);
+        if (submitted < 0) {
+            if (failed) {
+                // 无法等待在途请求完成，内核可能仍在写入缓冲区，只能不释放
+                perror("等待 io_uring 在途请求失败");
+                b->buffer = NULL;
+                return -1;
+            }
+            perror("io_uring 提交失败");
+            failed = 1;
+            continue;
+        }
+        unsubmitted -= submitted;
+        inflight += submitted;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        unsigned tail = __atomic_load_n(b->ring.cq_tail, __ATOMIC_ACQUIRE);
+
+        unsigned head = *b->ring.cq_head;
+        while (head != tail) {
+            struct io_uring_cqe *cqe = &b->ring.cqes[head & *b->ring.cq_mask];
+            unsigned id = (unsigned)cqe->user_data;
+            if (cqe->res == (int)cell->block_size) {
+                histogram_record(&hist, timespec_diff_us(&b->submit_time[id], &now));
+                bytes += cqe->res;
+            } else {
+                cell->errors++;
+            }
+            cell->ios++;
+            head++;
+            __atomic_store_n(b->ring.cq_head, head, __ATOMIC_RELEASE);
+            free_slots[free_count++] = id;
+            inflight--;
+        }
+    }
+
+    if (failed) return -1;
+
+    double elapsed_sec = timespec_diff_us(&start, &now) / (double)US_PER_SEC;
+    cell->measured = 1;
+    cell->iops = elapsed_sec > 0 ? cell->ios / elapsed_sec : 0;
+    cell->mb_per_sec = elapsed_sec > 0 ? bytes / (elapsed_sec * 1024 * 1024) : 0;
+    cell->p99_us = histogram_percentile(&hist, 99);
+    return 0;
+}
+
+// 基准测试结果文件：--bench-db 指定，默认为 $HOME 下的 BENCH_DB_FILE
+const char *bench_db_path(const ScanOptions *opts, char *buf, size_t size) {
+    if (opts->bench_db) return opts->bench_db;
+    const char *home = getenv("HOME");
+    if (!home || !*home) return NULL;
+    snprintf(buf, size, "%s/%s", home, BENCH_DB_FILE);
+    return buf;
+}
+
+// 型号未知时无法区分设备，不读写结果文件
+int bench_db_usable(const DeviceTypeInfo *dev_info) {
+    return strcmp(dev_info->model, "Unknown") != 0;
+}
+
+// 查找该型号的推荐参数。文件每行: 厂商,型号,块大小,队列深度,线程数,MB/s,p99(微秒)
+int bench_db_lookup(const char *path, const DeviceTypeInfo *dev_info, BenchResult *result) {
+    if (!path || !bench_db_usable(dev_info)) return -1;
+    FILE *file = fopen(path, "r");
+    if (!file) return -1;
+
+    int found = -1;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        char vendor[32] = {0}, model[64] = {0};
+        BenchResult entry;
+        if (sscanf(line, "%31[^,],%63[^,],%zu,%d,%d,%lf,%ld", vendor, model, &entry.block_size,
+                   &entry.queue_depth, &entry.threads, &entry.mb_per_sec, &entry.p99_us) == 7 &&
+            strcmp(vendor, dev_info->vendor) == 0 && strcmp(model, dev_info->model) == 0 &&
+            entry.block_size > 0 && entry.queue_depth >= 1 && entry.queue_depth <= MAX_QUEUE_DEPTH &&
+            entry.threads >= 1 && entry.threads <= MAX_THREADS) {
+            *result = entry;
+            found = 0;
+        }
+    }
+    fclose(file);
+    return found;
+}
+
+// 保存该型号的推荐参数，替换同一型号原有的行。先写临时文件再改名，避免中途失败损坏原文件
+int bench_db_store(const char *path, const DeviceTypeInfo *dev_info, const BenchResult *result) {
+    size_t path_len = strlen(path);
+    char *tmp_path = malloc(path_len + 5);
+    if (!tmp_path) return -1;
+    snprintf(tmp_path, path_len + 5, "%s.tmp", path);
+
+    FILE *out = fopen(tmp_path, "w");
+    if (!out) {
+        fprintf(stderr, "警告: 无法写入基准测试结果 '%s': %s\n", path, strerror(errno));
+        free(tmp_path);
+        return -1;
+    }
+
+    FILE *in = fopen(path, "r");
+    char line[256];
+    if (in) {
+        while (fgets(line, sizeof(line), in)) {
+            char vendor[32] = {0}, model[64] = {0};
+            if (line[0] != '#' && sscanf(line, "%31[^,],%63[^,],", vendor, model) == 2 &&
+                strcmp(vendor, dev_info->vendor) == 0 && strcmp(model, dev_info->model) == 0) {
+                continue;
+            }
+            fputs(line, out);
+        }
+        fclose(in);
+    } else {
+        fprintf(out, "# good-blocks 基准测试推荐参数\n# 厂商,型号,块大小,队列深度,线程数,MB/s,p99(微秒)\n");
+    }
+    fprintf(out, "%s,%s,%zu,%d,%d,%.1f,%ld\n", dev_info->vendor, dev_info->model, result->block_size,
+            result->queue_depth, result->threads, result->mb_per_sec, result->p99_us);
+
+    int ok = fflush(out) == 0 && fsync(fileno(out)) == 0;
+    if (fclose(out) != 0 || !ok || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "警告: 无法写入基准测试结果 '%s': %s\n", path, strerror(errno));
+        unlink(tmp_path);
+        free(tmp_path);
+        return -1;
+    }
+    free(tmp_path);
+    return 0;
+}
+
+// 以块大小为行、队列深度为列输出一项指标，value 返回 NULL 表示未测
+void print_bench_matrix(const char *title, const BenchCell *cells, int rows, int columns, const BenchCell *best,
+                        long ceiling, const char *(*value)(const BenchCell *, char *, size_t)) {
+    char text[32];
+    printf("------------------------\n%s\n  块大小 \\ 队列深度", title);
+    for (int c = 0; c < columns; c++) printf(" %9d", cells[c].queue_depth);
+    printf("\n");
+    for (int r = 0; r < rows; r++) {
+        const BenchCell *row = &cells[r * columns];
+        if (!row[0].measured) continue;
+        printf("  %17zu", row[0].block_size);
+        for (int c = 0; c < columns; c++) {
+            const char *s = row[c].measured ? value(&row[c], text, sizeof(text)) : "-";
+            char mark = (&row[c] == best) ? '<' : (row[c].measured && row[c].p99_us > ceiling) ? '*' : ' ';
+            printf(" %8s%c", s, mark);
+        }
+        printf("\n");
+    }
+}
+
+const char *bench_format_iops(const BenchCell *cell, char *buf, size_t size) {
+    snprintf(buf, size, "%.0f", cell->iops);
+    return buf;
+}
+
+const char *bench_format_rate(const BenchCell *cell, char *buf, size_t size) {
+    snprintf(buf, size, "%.1f", cell->mb_per_sec);
+    return buf;
+}
+
+const char *bench_format_p99(const BenchCell *cell, char *buf, size_t size) {
+    return format_latency(cell->p99_us, buf, size);
+}
+
+// bench 子命令的入口
+int run_benchmark(const ScanOptions *opts, const DeviceInfo *info, const DeviceTypeInfo *dev_info) {
+    static BenchContext b;
+    long ceiling = opts->bench_ceiling > 0 ? opts->bench_ceiling : opts->suspect_threshold;
+    b.base = (off_t)info->sector_offset * info->sector_size;
+    b.range_bytes = (off_t)info->block_count * info->sectors_per_block * info->sector_size;
+    b.random = opts->sample_ratio < 100.0;
+    b.cell_us = opts->bench_cell_us;
+    rng_seed(b.rng, opts->seed, MAX_THREADS + 1);
+
+    b.fd = open(opts->device, O_RDONLY | O_DIRECT);
+    if (b.fd == -1) {
+        fprintf(stderr, "错误: 无法打开设备 '%s': %s\n", opts->device, strerror(errno));
+        return 1;
+    }
+    long page_size = sysconf(_SC_PAGESIZE);
+    size_t align_size = (info->sector_size > page_size) ? info->sector_size : page_size;
+    if (posix_memalign(&b.buffer, align_size, BENCH_MAX_BLOCK)) {
+        perror("内存分配失败");
+        close(b.fd);
+        return 1;
+    }
+    if (uring_queue_init(&b.ring, BENCH_MAX_DEPTH) == 0) {
+        b.max_depth = b.ring.entries < BENCH_MAX_DEPTH ? b.ring.entries : BENCH_MAX_DEPTH;
+        for (unsigned i = 0; i < b.max_depth; i++) b.iov[i].iov_base = b.buffer;
+    } else {
+        fprintf(stderr, "警告: io_uring 初始化失败 (%s)，只测量队列深度 1 的同步读取\n", strerror(errno));
+    }
+
+    // 块大小和队列深度都按 2 倍递增
+    int rows = 0, columns = 0;
+    for (size_t bs = BENCH_MIN_BLOCK; bs <= BENCH_MAX_BLOCK; bs *= 2) rows++;
+    for (unsigned qd = 1; qd <= (b.max_depth > 0 ? b.max_depth : 1); qd *= 2) columns++;
+    BenchCell *cells = calloc((size_t)rows * columns, sizeof(BenchCell));
+    if (!cells) {
+        perror("内存分配失败");
+        if (b.max_depth > 0) uring_queue_exit(&b.ring);
+        close(b.fd);
+        free(b.buffer);
+        return 1;
+    }
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < columns; c++) {
+            cells[r * columns + c].block_size = (size_t)BENCH_MIN_BLOCK << r;
+            cells[r * columns + c].queue_depth = 1 << c;
+        }
+    }
+    install_interrupt_handler();
+
+    char latency[32], duration[32];
+    printf("\033[35m【基准测试】\033[m访问方式: %s | 每个组合: %s | 延迟上限 (p99): %s\n",
+           b.random ? "随机位置" : "顺序读取", format_latency(b.cell_us, duration, sizeof(duration)),
+           format_latency(ceiling, latency, sizeof(latency)));
+    printf("====================================================================================================\n");
+
+    int result = 0;
+    for (int r = 0; r < rows && !scan_interrupted && result == 0; r++) {
+        BenchCell *row = &cells[r * columns];
+        if (row[0].block_size % info->sector_size != 0 || (off_t)row[0].block_size > b.range_bytes) continue;
+
+        double best_rate = 0;
+        for (int c = 0; c < columns && !scan_interrupted; c++) {
+            if (bench_measure_cell(&b, &row[c]) != 0) {
+                result = 1;
+                break;
+            }
+            printf("\r块大小: %8zu | 队列深度: %3d | %9.0f IOPS | %8.1f MB/s | p99: %-8s%s   ",
+                   row[c].block_size, row[c].queue_depth, row[c].iops, row[c].mb_per_sec,
+                   format_latency(row[c].p99_us, latency, sizeof(latency)),
+                   row[c].errors > 0 ? " (读取错误)" : "");
+            fflush(stdout);
+
+            // 超过延迟上限后，加大队列深度只会让延迟更高，速度也不再明显提升时停止本行
+            if (row[c].p99_us > ceiling && row[c].mb_per_sec < best_rate * (2 - BENCH_NEAR_BEST)) break;
+            if (row[c].mb_per_sec > best_rate) best_rate = row[c].mb_per_sec;
+        }
+    }
+    printf("\n\n");
+    if (b.max_depth > 0) uring_queue_exit(&b.ring);
+    close(b.fd);
+    free(b.buffer);
+    if (scan_interrupted) printf("\033[33m【基准测试】\033[m已中断，只输出已测的组合\n");
+
+    // 在满足延迟上限的组合中找最快的，速度相差不到 5% 时优先选更小的块（慢块定位更精细）和更小的队列深度
+    double best_rate = 0;
+    for (int i = 0; i < rows * columns; i++) {
+        if (cells[i].measured && cells[i].errors == 0 && cells[i].p99_us <= ceiling &&
+            cells[i].mb_per_sec > best_rate) {
+            best_rate = cells[i].mb_per_sec;
+        }
+    }
+    const BenchCell *best = NULL;
+    for (int i = 0; i < rows * columns && !best; i++) {
+        if (cells[i].measured && cells[i].errors == 0 && cells[i].p99_us <= ceiling &&
+            cells[i].mb_per_sec >= best_rate * BENCH_NEAR_BEST && best_rate > 0) {
+            best = &cells[i];
         }
-        fprintf(logfile, "# 扫描完成时间: %ld\n", (long)time(NULL));
     }
+
+    printf("基准测试报告 (* 表示 p99 超过延迟上限，< 为推荐组合)\n");
+    print_bench_matrix("IOPS:", cells, rows, columns, best, ceiling, bench_format_iops);
+    print_bench_matrix("速度 (MB/s):", cells, rows, columns, best, ceiling, bench_format_rate);
+    print_bench_matrix("p99 延迟:", cells, rows, columns, best, ceiling, bench_format_p99);
+    printf("------------------------\n");
+
+    if (!best) {
+        printf("\033[33m【基准测试】\033[m没有组合满足延迟上限 %s，不给出推荐\n",
+               format_latency(ceiling, latency, sizeof(latency)));
+        free(cells);
+        return 1;
+    }
+
+    // 多线程引擎每个线程一个在途请求；机械硬盘多线程分段读取会来回寻道，仍用单线程
+    BenchResult tuned = {
+        .block_size  = best->block_size,
+        .queue_depth = best->queue_depth,
+        .threads     = dev_info->is_rotational == 1 ? 1 :
+                       (best->queue_depth < MAX_THREADS ? best->queue_depth : MAX_THREADS),
+        .mb_per_sec  = best->mb_per_sec,
+        .p99_us      = best->p99_us,
+    };
+    printf("\033[35m【基准测试】\033[m推荐参数: -b %zu -e uring -q %d（或 -e threads -t %d）| %.1f MB/s，p99 %s\n",
+           tuned.block_size, tuned.queue_depth, tuned.threads, tuned.mb_per_sec,
+           format_latency(tuned.p99_us, latency, sizeof(latency)));
+
+    char path_buf[512];
+    const char *path = bench_db_path(opts, path_buf, sizeof(path_buf));
+    if (scan_interrupted) {
+        result = 1;
+    } else if (!bench_db_usable(dev_info)) {
+        printf("\033[35m【基准测试】\033[m设备型号未知，不保存推荐参数\n");
+    } else if (path && bench_db_store(path, dev_info, &tuned) == 0) {
+        printf("\033[35m【基准测试】\033[m已保存到 %s，以后扫描 %s %s 时未指定 -q/-t 将使用推荐值\n",
+               path, dev_info->vendor, dev_info->model);
+    }
+    free(cells);
+    return result;
 }
 
 int main(int argc, char *argv[]) {
@@ -1052,35 +6091,123 @@ int main(int argc, char *argv[]) {
     DeviceInfo device_info;
     DeviceTypeInfo device_type_info;
     TimeCategory categories[MAX_CATEGORIES];
+    static ScanStats stats;
     int cat_count = 0;
     int fd = -1;
     void *buffer = NULL;
     FILE *logfile = NULL;
+    FILE *binlog = NULL;
+    FILE *events = NULL;
+    ScanLogger logger = { NULL };
+    int logger_started = 0;
+    unsigned char *latency_map = NULL;
+    size_t latency_map_length = 0;
+    unsigned char *coverage = NULL;
+    size_t coverage_length = 0;
+    ScanCheckpoint checkpoint = { NULL };
+    int interrupted = 0;
+
+    // 查看延迟图
+    if (argc >= 3 && strcmp(argv[1], "map") == 0) {
+        long threshold = DEFAULT_SUSPECT_THRESHOLD;
+        if (argc >= 4 && parse_latency(argv[3], &threshold) != 0) {
+            fprintf(stderr, "错误: 无效的阈值 '%s'\n", argv[3]);
+            return 1;
+        }
+        return dump_latency_map(argv[2], threshold);
+    }
+
+    // 把二进制日志转换为文本格式
+    if (argc == 3 && strcmp(argv[1], "log") == 0) {
+        return convert_binary_log(argv[2]);
+    }
+
+    // 基准测试：其余参数与扫描相同
+    int bench = argc >= 2 && strcmp(argv[1], "bench") == 0;
+    if (bench) {
+        argv[1] = argv[0];
+        argc--;
+        argv++;
+    }
 
     // 解析命令行参数
     if (parse_arguments(argc, argv, &opts) != 0) {
         return 1;
     }
+    int top_requested = opts.top_ranges > 0;
+    if (!top_requested) opts.top_ranges = DEFAULT_TOP_RANGES;
 
     // 获取设备信息
-    if (get_device_info(opts.device, opts.start_str, opts.end_str, opts.block_size, &device_info) != 0) {
+    if (get_device_info(opts.device, opts.start_str, opts.end_str, opts.block_size,
+                        opts.fine_block_size, &device_info) != 0) {
         return 1;
     }
 
     // 检测设备类型
     if (detect_device_type(opts.device, &device_type_info) == 0) {
+        // 系统不提供转速，需要时实测
+        if (opts.calibrate) {
+            calibrate_rotation(&opts, &device_info, &device_type_info);
+        }
+
         // 如果用户没有指定可疑块阈值，使用推荐值
         if (opts.suspect_threshold == DEFAULT_SUSPECT_THRESHOLD) {
-            int recommended = get_recommended_suspect_threshold(&device_type_info);
+            long recommended = get_recommended_suspect_threshold(&device_type_info);
             if (recommended != DEFAULT_SUSPECT_THRESHOLD) {
+                char latency[32];
                 opts.suspect_threshold = recommended;
-                printf("\033[33m【准备扫描】\033[m根据设备类型自动调整可疑块阈值为: %d ms\n", recommended);
+                printf("\033[33m【准备扫描】\033[m根据设备类型自动调整可疑块阈值为: %s\n",
+                       format_latency(recommended, latency, sizeof(latency)));
             }
         }
     } else {
         printf("\033[33m【准备扫描】\033[m警告: 无法检测设备类型，将使用默认配置\n");
     }
 
+    opts.rotational = device_type_info.is_rotational == 1;
+
+    if (bench) {
+        return run_benchmark(&opts, &device_info, &device_type_info);
+    }
+
+    // 有该型号的基准测试结果时，用推荐值作为队列深度和线程数的默认值
+    char bench_db_buf[512];
+    BenchResult tuned;
+    int have_tuned = bench_db_lookup(bench_db_path(&opts, bench_db_buf, sizeof(bench_db_buf)),
+                                     &device_type_info, &tuned) == 0;
+    if (have_tuned && tuned.block_size != opts.block_size) {
+        printf("\033[33m【准备扫描】\033[m该型号的基准测试推荐块大小为 %zu 字节（-b），当前为 %zu 字节\n",
+               tuned.block_size, opts.block_size);
+    }
+    if (opts.queue_depth == 0) {
+        opts.queue_depth = have_tuned ? tuned.queue_depth : DEFAULT_QUEUE_DEPTH;
+        if (have_tuned && (opts.engine == ENGINE_URING || opts.profile_file)) {
+            printf("\033[33m【准备扫描】\033[m使用该型号的基准测试结果，队列深度: %d\n", opts.queue_depth);
+        }
+    }
+
+    // 吞吐曲线模式不按延迟分类，不需要后面的扫描环境
+    if (opts.profile_file) {
+        return run_throughput_profile(&opts, &device_info);
+    }
+
+    // 低差异序列未指定窗口时：机械硬盘按窗口排序读取以减少寻道，SSD 不需要
+    if (opts.low_discrepancy && opts.ldc_window == 0) {
+        opts.ldc_window = device_type_info.is_rotational == 1 ? DEFAULT_LDC_WINDOW_HDD : 1;
+        printf("\033[33m【准备扫描】\033[m低差异序列排序窗口: %lu 块\n", opts.ldc_window);
+    }
+
+    // 多线程引擎未指定线程数时按基准测试结果或设备类型选择（续扫时以断点为准，见下）
+    if (opts.engine == ENGINE_THREADS && opts.threads == 0 && !opts.resume) {
+        if (have_tuned) {
+            opts.threads = tuned.threads;
+            printf("\033[33m【准备扫描】\033[m使用该型号的基准测试结果，线程数: %d\n", opts.threads);
+        } else {
+            opts.threads = get_recommended_thread_count(&device_type_info);
+            printf("\033[33m【准备扫描】\033[m根据设备类型自动选择线程数: %d\n", opts.threads);
+        }
+    }
+
     // 加载时间分类配置
     if (opts.config_file) {
         cat_count = load_categories(opts.config_file, categories);
@@ -1105,6 +6232,64 @@ int main(int argc, char *argv[]) {
     for (int i = 0; i < cat_count; i++) {
         categories[i].count = 0;
     }
+    scan_stats_init(&stats);
+
+    struct timespec scan_start;
+    clock_gettime(CLOCK_MONOTONIC, &scan_start);
+
+    if (opts.checkpoint_file) {
+        checkpoint.path = opts.checkpoint_file;
+        checkpoint.interval = opts.checkpoint_interval;
+        if (opts.resume) {
+            if (checkpoint_load(&checkpoint, &opts, &device_info, cat_count) != 0) {
+                goto cleanup;
+            }
+            checkpoint_restore(&checkpoint, categories, cat_count, &stats, &scan_start);
+            if (opts.random_sampling && opts.seed != checkpoint.header.seed) {
+                opts.seed = checkpoint.header.seed;
+                printf("\033[33m【断点续扫】\033[m沿用断点中的随机种子: %llu\n", (unsigned long long)opts.seed);
+            }
+
+            // 断点中的迭代器布局决定读取引擎：多个迭代器只能由同样线程数的多线程引擎继续
+            if (checkpoint.header.iterator_count > 1) {
+                opts.engine = ENGINE_THREADS;
+                opts.threads = checkpoint.header.iterator_count;
+                printf("\033[33m【断点续扫】\033[m使用多线程引擎继续，线程数: %d\n", opts.threads);
+            } else if (opts.engine == ENGINE_THREADS) {
+                opts.engine = ENGINE_SYNC;
+                printf("\033[33m【断点续扫】\033[m断点来自单线程扫描，改用同步读取引擎继续\n");
+            }
+        }
+        install_interrupt_handler();
+    }
+
+    if (opts.latency_map_file) {
+        latency_map = latency_map_create(opts.latency_map_file, &device_info, opts.block_size,
+                                         &latency_map_length, opts.resume);
+        if (!latency_map) goto cleanup;
+    }
+
+    if (opts.coverage_file) {
+        coverage = coverage_open(opts.coverage_file, &device_info, opts.block_size,
+                                 &coverage_length, opts.resume);
+        if (!coverage) goto cleanup;
+    }
+
+    if (opts.binlog_file) {
+        binlog = binlog_open(opts.binlog_file, opts.device, &device_info, opts.block_size,
+                             categories, cat_count, opts.resume);
+    }
+    if (opts.events_target) {
+        events = events_open(opts.events_target, opts.resume);
+    }
+    // 日志线程同时负责把慢块合并成区间，只在有日志输出或需要区间时启动
+    int need_logger = logfile || binlog || events || opts.json_file || opts.ranges_file ||
+                      opts.badblocks_file || top_requested;
+    if (need_logger && scan_logger_start(&logger, logfile, binlog, events, categories, cat_count) == 0) {
+        logger_started = 1;
+    }
+    if (events) events_write_start(events, &opts, &device_info, categories, cat_count);
+    time_t started_at = time(NULL);
 
     // 打印扫描信息
     // printf("扇区偏移量: %lu\n", device_info.sector_offset);
@@ -1117,19 +6302,61 @@ int main(int argc, char *argv[]) {
         goto cleanup;
     }
 
-    struct timespec scan_start;
-    clock_gettime(CLOCK_MONOTONIC, &scan_start);
-
     // 执行扫描
-    perform_scan(fd, buffer, &opts, &device_info, categories, cat_count, logfile);
+    int scan_result = perform_scan(fd, buffer, &opts, &device_info, categories, cat_count, &stats,
+                                   logger_started ? &logger : NULL, latency_map, coverage,
+                                   opts.checkpoint_file ? &checkpoint : NULL);
+    // 日志线程写完剩余记录后，报告才能继续写入日志文件
+    if (logger_started) {
+        scan_logger_finish(&logger);
+    }
+    if (events) events_write_end(events, scan_result != 0, &stats, &scan_start);
+    if (scan_result < 0) {
+        interrupted = 1;
+        goto cleanup;
+    }
+    if (scan_result != 0) {
+        interrupted = 1;
+        printf("\033[33m【断点续扫】\033[m扫描已中断，进度已保存到 %s，加上 --resume 重新运行即可继续\n",
+               opts.checkpoint_file);
+        goto cleanup;
+    }
 
     // 生成最终报告
-    generate_final_report(&opts, &device_info, categories, cat_count, &scan_start, logfile);
+    generate_final_report(&opts, &device_info, categories, cat_count, &stats,
+                          logger_started ? &logger : NULL, &scan_start, logfile);
+    if (opts.heatmap_file && strcmp(opts.heatmap_file, "-") != 0) {
+        write_heatmap(opts.heatmap_file, &stats, &device_info);
+    }
+    if (logger_started && opts.ranges_file) {
+        export_ranges(opts.ranges_file, &logger);
+    }
+    if (logger_started && opts.badblocks_file) {
+        export_badblocks(opts.badblocks_file, &logger, &device_info, opts.fs_block_size);
+    }
+    if (opts.json_file) {
+        write_json_report(opts.json_file, &opts, &device_info, &device_type_info, categories, cat_count,
+                          &stats, logger_started ? &logger : NULL, &scan_start, started_at);
+    }
+    coverage_close(coverage, coverage_length, device_info.block_count, logfile);
+    coverage = NULL;
+
+    // 扫描已完成，断点不再需要
+    if (opts.checkpoint_file) {
+        unlink(opts.checkpoint_file);
+    }
 
 cleanup:
+    if (logger_started) scan_logger_free(&logger);
     if (buffer) free(buffer);
     if (fd >= 0) close(fd);
     if (logfile) fclose(logfile);
-
-    return 0;
+    if (binlog) fclose(binlog);
+    if (events) fclose(events);
+    latency_map_close(latency_map, latency_map_length);
+    coverage_close(coverage, coverage_length, device_info.block_count, NULL);
+    free(checkpoint.iterators);
+    free(checkpoint.pending);
+
+    return interrupted;
 }
@@ -0,0 +1,77 @@
+// 日志环形队列测试：多个线程写入的记录数远超 LOG_RING_SIZE，
+// 检查队列回绕后不会死锁，且每条记录恰好写出一次
+#define main good_blocks_main
+#include "../main.c"
+#undef main
+
+#define TEST_PRODUCERS  4
+#define TEST_RECORDS    50000   // 每个线程，合计约为 LOG_RING_SIZE 的 3 倍
+
+typedef struct {
+    ScanLogger  *logger;
+    pthread_t   thread;
+    int         id;
+} Producer;
+
+void *producer_thread(void *arg) {
+    Producer *producer = arg;
+    for (int i = 0; i < TEST_RECORDS; i++) {
+        log_block(producer->logger, (unsigned long)producer->id * TEST_RECORDS + i, 8, i, 0, 0);
+    }
+    return NULL;
+}
+
+int main(void) {
+    TimeCategory categories[2] = { { .name = "正常" }, { .name = "坏道" } };
+    ScanLogger logger;
+    FILE *binary = tmpfile();
+    if (!binary || scan_logger_start(&logger, NULL, binary, NULL, categories, 2) != 0) {
+        fprintf(stderr, "失败: 无法启动日志线程\n");
+        return 1;
+    }
+
+    alarm(60);  // 死锁时由 SIGALRM 结束进程
+    Producer producers[TEST_PRODUCERS];
+    for (int i = 0; i < TEST_PRODUCERS; i++) {
+        producers[i] = (Producer){ .logger = &logger, .id = i };
+        if (pthread_create(&producers[i].thread, NULL, producer_thread, &producers[i]) != 0) {
+            fprintf(stderr, "失败: 无法创建写入线程\n");
+            return 1;
+        }
+    }
+    for (int i = 0; i < TEST_PRODUCERS; i++) {
+        pthread_join(producers[i].thread, NULL);
+    }
+    scan_logger_free(&logger);
+    alarm(0);
+
+    const unsigned long total = (unsigned long)TEST_PRODUCERS * TEST_RECORDS;
+    unsigned char *seen = calloc(total, 1);
+    if (!seen) {
+        perror("内存分配失败");
+        return 1;
+    }
+
+    rewind(binary);
+    LogRecord record;
+    unsigned long count = 0;
+    int failed = 0;
+    while (fread(&record, sizeof(record), 1, binary) == 1) {
+        count++;
+        if (record.sector >= total || record.sectors != 8 || seen[record.sector]++) {
+            fprintf(stderr, "失败: 扇区 %lu 的记录无效或重复\n", (unsigned long)record.sector);
+            failed = 1;
+            break;
+        }
+    }
+    if (!failed && count != total) {
+        fprintf(stderr, "失败: 写出 %lu 条记录，应为 %lu 条\n", count, total);
+        failed = 1;
+    }
+
+    free(seen);
+    fclose(binary);
+    if (failed) return 1;
+    printf("通过: %lu 条记录（队列容量 %d）\n", count, LOG_RING_SIZE);
+    return 0;
+}